@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+
+#include "hal.h"
+
+using namespace std;
+
+// 지터를 섞은 지수 백오프(호스트에서 빌드 가능)
+// 서버 재시작 등으로 여러 기기가 동시에 끊겨도 재연결 시각이 흩어지도록 함
+namespace backoff{
+    struct Backoff{
+        uint32_t base; // ms, 첫 대기 시간
+        uint32_t cap; // ms, 최대 대기 시간
+        uint8_t attempt = 0;
+
+        Backoff(uint32_t base, uint32_t cap) : base(base), cap(cap){}
+
+        // [limit / 2, limit] 범위에서 선택(equal jitter), limit = min(cap, base * 2^attempt)
+        uint32_t next(){
+            uint32_t limit = (uint32_t) min<uint64_t>(cap, (uint64_t) base << attempt);
+            if(limit < cap){
+                ++attempt;
+            }
+            uint32_t half = limit / 2;
+            return half + hal::random() % (limit - half + 1);
+        }
+
+        void reset(){
+            attempt = 0;
+        }
+    };
+}
\ No newline at end of file
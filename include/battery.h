@@ -1,49 +1,224 @@
 #pragma once
 
 #include <atomic>
-#include <iostream>
 
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#include <esp_idf_version.h>
+#include <esp_adc/adc_continuous.h>
+#include <esp_adc/adc_cali.h>
+#include <esp_adc/adc_cali_scheme.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#include "hal.h"
+#include "logger.h"
 #include "utils.h"
+#include "filter.h"
+
+#define BATTERY_PIN GPIO_NUM_1
+#define BATTERY_DIVIDER_NUM 2038 // 분압 저항 비율(측정값) = NUM / DEN
+#define BATTERY_DIVIDER_DEN 1000
+
+#define CHECK_COUNT 64 // 한 번에 측정할 횟수(DMA)
+#define CHECK_FREQUENCY 20000 // 샘플링 주파수(Hz)
+#define CHECK_INTERVAL 5000 // 측정 간격(ms)
+#define CHECK_EMA_SHIFT 2 // EMA 계수 = 1 / 2^SHIFT
 
-#define CHECK_TICK 10 // 확인할 간격
-#define CHECK_COUNT 100 // 측정할 횟수
-#define CHECK_INTERVAL 5000 // 확인 후 간격
+// 측정(ADC)은 readSamples, toMilliVolt로 분리, 호스트 빌드에서는 hal::adcRead의 값을 12비트 원시값으로 사용
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define BATTERY_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define BATTERY_OUTPUT_DATA(output) ((output)->type1.data)
+#else
+#define BATTERY_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define BATTERY_OUTPUT_DATA(output) ((output)->type2.data)
+#endif
 
 using namespace std;
 
 namespace battery{
+    // 전압 -> 잔량(0 ~ 10) 변환표(리튬이온 1셀 방전 곡선), 전압 오름차순
+    static constexpr filter::curve_point_t curve[] = {
+        {3300, 0},
+        {3600, 1},
+        {3680, 2},
+        {3740, 3},
+        {3770, 4},
+        {3800, 5},
+        {3850, 6},
+        {3920, 7},
+        {3980, 8},
+        {4060, 9},
+        {4150, 10},
+    };
+
     atomic<uint8_t> level = 0;
+    atomic<uint16_t> milliVolt = 0;
+
+    static filter::Ema<CHECK_EMA_SHIFT> average;
 
     static uint8_t voltToLevel(uint16_t mVolt){
         if(mVolt < 1000){ // 배터리 연결이 안되어있는 장치라고 판단
             return 15;
         }
-        int16_t calculate = (mVolt - 3550) * 10 / (4150 - 3550);
-        cout << "[battery] raw volt: " << mVolt << ", value: " << (calculate * 10) << "%\n";
-        return (uint8_t) MIN(10, MAX(0, calculate));
+
+        uint8_t calculate = filter::levelOf(curve, sizeof(curve) / sizeof(curve[0]), mVolt);
+        LOG_DEBUG("[battery] raw volt: %u, value: %u%%", mVolt, calculate * 10);
+        return calculate;
     }
 
-    void calculate(void* args){
-        level = voltToLevel(analogReadMilliVolts(GPIO_NUM_1) * 2.038);
+#ifdef ESP_PLATFORM
+    static TaskHandle_t task = NULL;
+    static esp_timer_handle_t timer = NULL;
+    static adc_continuous_handle_t adc = NULL;
+    static adc_cali_handle_t cali = NULL;
+    static adc_channel_t channel;
+
+    static bool initAdc(){
+        adc_unit_t unit;
+        if(adc_continuous_io_to_channel(BATTERY_PIN, &unit, &channel) != ESP_OK){
+            return false;
+        }
+
+        adc_continuous_handle_cfg_t handleConfig = {
+            .max_store_buf_size = CHECK_COUNT * SOC_ADC_DIGI_RESULT_BYTES * 2,
+            .conv_frame_size = CHECK_COUNT * SOC_ADC_DIGI_RESULT_BYTES,
+        };
+        ESP_ERROR_CHECK(adc_continuous_new_handle(&handleConfig, &adc));
+
+        adc_digi_pattern_config_t pattern = {
+            .atten = ADC_ATTEN_DB_11,
+            .channel = (uint8_t) channel,
+            .unit = (uint8_t) unit,
+            .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+        };
+        adc_continuous_config_t config = {
+            .pattern_num = 1,
+            .adc_pattern = &pattern,
+            .sample_freq_hz = CHECK_FREQUENCY,
+            .conv_mode = unit == ADC_UNIT_1 ? ADC_CONV_SINGLE_UNIT_1 : ADC_CONV_SINGLE_UNIT_2,
+            .format = BATTERY_OUTPUT_FORMAT,
+        };
+        ESP_ERROR_CHECK(adc_continuous_config(adc, &config));
+
+        // eFuse에 기록된 보정값 사용
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+        adc_cali_curve_fitting_config_t caliConfig = {
+            .unit_id = unit,
+            .atten = ADC_ATTEN_DB_11,
+            .bitwidth = (adc_bitwidth_t) SOC_ADC_DIGI_MAX_BITWIDTH,
+        };
+        if(adc_cali_create_scheme_curve_fitting(&caliConfig, &cali) != ESP_OK){
+            cali = NULL;
+        }
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+        adc_cali_line_fitting_config_t caliConfig = {
+            .unit_id = unit,
+            .atten = ADC_ATTEN_DB_11,
+            .bitwidth = (adc_bitwidth_t) SOC_ADC_DIGI_MAX_BITWIDTH,
+        };
+        if(adc_cali_create_scheme_line_fitting(&caliConfig, &cali) != ESP_OK){
+            cali = NULL;
+        }
+#endif
+        if(cali == NULL){
+            LOG_WARN("[battery] ADC 보정값이 없습니다.");
+        }
+        return true;
+    }
+
+    // DMA로 최대 CHECK_COUNT개를 측정, 읽은 개수를 반환(실패시 0)
+    // 정지 후에도 풀에 남은 이전 측정값(라이트 슬립, DFS 전)이 먼저 읽히지 않도록 시작 전에 비움
+    static uint16_t readSamples(uint16_t* samples){
+        static uint8_t buffer[CHECK_COUNT * SOC_ADC_DIGI_RESULT_BYTES];
+        uint32_t timeout = CHECK_COUNT * 1000 / CHECK_FREQUENCY + 100;
+
+        uint32_t length = 0;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+        adc_continuous_flush_pool(adc);
+        ESP_ERROR_CHECK(adc_continuous_start(adc));
+        esp_err_t err = adc_continuous_read(adc, buffer, sizeof(buffer), &length, timeout);
+#else
+        // adc_continuous_flush_pool이 없는 버전은 시작 직후 바로 읽히는 프레임(남아 있던 값)을 모두 버림
+        ESP_ERROR_CHECK(adc_continuous_start(adc));
+        while(adc_continuous_read(adc, buffer, sizeof(buffer), &length, 0) == ESP_OK){
+        }
+        esp_err_t err = adc_continuous_read(adc, buffer, sizeof(buffer), &length, timeout);
+#endif
+        adc_continuous_stop(adc);
+        if(err != ESP_OK){
+            return 0;
+        }
 
-        uint64_t sum = 0;
         uint16_t count = 0;
-        uint64_t time = millis();
+        for(uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES){
+            samples[count++] = BATTERY_OUTPUT_DATA((adc_digi_output_data_t*) &buffer[i]);
+        }
+        return count;
+    }
+
+    // 원시값 -> ADC 입력 전압(mV), 보정값이 없으면 선형 근사
+    static uint32_t toMilliVolt(int raw){
+        int mVolt = 0;
+        if(cali == NULL || adc_cali_raw_to_voltage(cali, raw, &mVolt) != ESP_OK){
+            mVolt = raw * 3100 / ((1 << SOC_ADC_DIGI_MAX_BITWIDTH) - 1);
+        }
+        return mVolt;
+    }
+#else
+    static uint16_t readSamples(uint16_t* samples){
+        return hal::adcRead(samples, CHECK_COUNT);
+    }
+
+    static uint32_t toMilliVolt(int raw){
+        return raw * 3100 / 4095;
+    }
+#endif
+
+    // 중앙값을 보정 전압(mV, 분압 전)으로 변환, 실패시 0
+    static uint16_t measure(){
+        static uint16_t samples[CHECK_COUNT];
+        uint16_t count = readSamples(samples);
+        if(count == 0){
+            return 0;
+        }
+        return toMilliVolt(filter::median(samples, count)) * BATTERY_DIVIDER_NUM / BATTERY_DIVIDER_DEN;
+    }
+
+    // 측정 후 EMA, 잔량 갱신, 측정에 실패하면 이전 값 유지
+    void update(){
+        uint16_t mVolt = measure();
+        if(mVolt > 0){
+            milliVolt = average.update(mVolt);
+            level = voltToLevel(milliVolt);
+        }
+    }
+
+#ifdef ESP_PLATFORM
+    static void notify(void* args){
+        xTaskNotifyGive(task);
+    }
+
+    void calculate(void* args){
+        task = xTaskGetCurrentTaskHandle();
+        if(!initAdc()){
+            LOG_ERROR("[battery] ADC 채널을 찾을 수 없습니다.");
+            vTaskDelete(NULL);
+            return;
+        }
+
+        esp_timer_create_args_t timerArgs = {
+            .callback = notify,
+            .name = "battery",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&timerArgs, &timer));
+        ESP_ERROR_CHECK(esp_timer_start_periodic(timer, CHECK_INTERVAL * 1000ULL));
+
         for(;;){
-            if(millis() - time < CHECK_TICK){
-                continue;
-            }
-            if(count < CHECK_COUNT){
-                ++count;
-                time = millis();
-                sum += analogReadMilliVolts(GPIO_NUM_1) * 2.038;
-                if(count >= CHECK_COUNT){
-                    level = voltToLevel(sum / count);
-                }
-            }else if(millis() - time > CHECK_INTERVAL){
-                time = millis();
-                sum = count = 0;
-            }
+            update();
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         }
     }
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <stdio.h>
+#include <inttypes.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "logger.h"
+#include "touch.h"
+#include "trace.h"
+#include "outbox.h"
+#include "protocol.h"
+#include "websocket.h"
+
+#define CAPTURE_INTERVAL 10 // 측정 간격(ms), 폴링 모드의 TOUCH_POLL_INTERVAL과 같음
+#define CAPTURE_MAX_DURATION 600 // s
+#define CAPTURE_CHUNK_SIZE (OUTBOX_FRAME_SIZE - 7) // CAPTURE_DATA_V2 헤더 제외
+
+static_assert(TOUCH_MAX_PADS <= TRACE_MAX_CHANNELS, "기록 형식의 채널 수 초과");
+
+// 터치 원시값을 trace.h 형식으로 기록해 웹소켓(v2)과 시리얼로 전송, native/touch_replay로 재생
+// 시리얼: [Capture] <offset> <hex>, 웹소켓: CAPTURE_DATA_V2, 둘 다 데이터가 없는 조각이 기록 끝
+namespace capture{
+    static TaskHandle_t task = NULL;
+    static atomic<bool> running = false;
+    static atomic<uint8_t> events = 0; // 다음 측정에 기록할 터치 판정 채널
+    static uint16_t sequence = 0;
+    static uint32_t duration = 0; // s
+
+    // 기록 중 touchTask가 터치로 판정하면 호출
+    void mark(uint8_t channel){
+        if(running){
+            events |= 1 << channel;
+        }
+    }
+
+    // 기록 데이터는 양이 많아 로그 버퍼를 거치지 않고 직접 출력
+    static void emit(uint32_t offset, const uint8_t* data, uint16_t length){
+        printf("[Capture] %" PRIu32 " ", offset);
+        for(uint16_t i = 0; i < length; ++i){
+            printf("%02x", data[i]);
+        }
+        printf("\n");
+
+        if(ws::connectServer && outbox::version >= 2){
+            protocol::capture_data_t chunk = {
+                .sequence = sequence,
+                .offset = offset,
+                .data = data,
+                .length = length,
+            };
+            uint8_t buffer[OUTBOX_FRAME_SIZE];
+            protocol::Writer writer(buffer, sizeof(buffer));
+            if(protocol::encodeCaptureData(writer, chunk)){
+                outbox::push(buffer, writer.length);
+            }
+        }
+    }
+
+    static void captureTask(void* args){
+        trace::header_t header = {
+            .channelCount = touch::padCount,
+            .interval = CAPTURE_INTERVAL,
+        };
+        for(uint8_t i = 0; i < header.channelCount; ++i){
+            header.baselines[i] = touch::baseline(i);
+        }
+        trace::Encoder encoder(header);
+
+        uint8_t chunk[CAPTURE_CHUNK_SIZE];
+        uint32_t offset = 0;
+        protocol::Writer writer(chunk, sizeof(chunk));
+        trace::encodeHeader(writer, header);
+
+        LOG_INFO("[Capture] 시작, %u초, channel: %u", duration, header.channelCount);
+        int64_t start = esp_timer_get_time();
+        int64_t end = start + duration * 1000000LL;
+        TickType_t wake = xTaskGetTickCount();
+        for(int64_t now = start; running && now < end; now = esp_timer_get_time()){
+            trace::sample_t sample = {
+                .tick = (uint32_t) ((now - start) / (CAPTURE_INTERVAL * 1000)),
+                .events = events.exchange(0),
+            };
+            for(uint8_t i = 0; i < header.channelCount; ++i){
+                sample.values[i] = touch::raw(i);
+            }
+            if(writer.capacity - writer.length < TRACE_RECORD_MAX){
+                emit(offset, chunk, writer.length);
+                offset += writer.length;
+                writer = protocol::Writer(chunk, sizeof(chunk));
+            }
+            encoder.encode(writer, sample);
+            vTaskDelayUntil(&wake, pdMS_TO_TICKS(CAPTURE_INTERVAL));
+        }
+        emit(offset, chunk, writer.length);
+        offset += writer.length;
+        emit(offset, NULL, 0);
+        LOG_INFO("[Capture] 종료, %u bytes", offset);
+
+        running = false;
+        task = NULL;
+        vTaskDelete(NULL);
+    }
+
+    // seconds가 0이면 진행 중인 기록을 중지, 이미 기록 중이면 false
+    bool start(uint16_t requestSequence, uint16_t seconds){
+        if(seconds == 0){
+            running = false;
+            return true;
+        }
+        if(running){
+            return false;
+        }
+        sequence = requestSequence;
+        duration = MIN(seconds, CAPTURE_MAX_DURATION);
+        events = 0;
+        running = true;
+        if(xTaskCreate(captureTask, "capture", 4096, NULL, 2, &task) != pdPASS){
+            running = false;
+            return false;
+        }
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+// 스위치 채널 구성표, 빌드 시 SWITCH_GANG(1, 2, 4)으로 선택(호스트에서 빌드 가능)
+// 서보 duty는 컴파일 시점에 계산됨
+
+#ifndef SWITCH_GANG
+#define SWITCH_GANG 2
+#endif
+
+#define FREQUENCY 50
+#define MAX_ANGLE 180
+#define MIN_WIDTH_US 500
+#define MAX_WIDTH_US 2500
+#define DUTY_BITS 14 // 페이드 단계가 촘촘하도록 14비트 사용
+
+namespace config{
+    // 목표 각도까지 LEDC 페이드로 이동 -> holdTime 유지 -> (releaseDuty로 복귀) -> PWM 종료
+    typedef struct{
+        uint16_t rampTime; // ms, 0이면 즉시 이동
+        uint16_t holdTime; // ms, 이동 완료 후 유지 시간
+        uint32_t releaseDuty; // 0이면 복귀하지 않음
+        uint16_t releaseTime; // ms
+    } profile_t;
+
+    typedef struct{
+        uint8_t servoPin;
+        uint8_t touchPin;
+        uint32_t onDuty;
+        uint32_t offDuty;
+        uint16_t lockout; // ms, 터치 연속 입력 방지
+        profile_t profile;
+    } channel_t;
+
+    // 각도 -> 펄스 폭(us) -> duty, 반올림
+    constexpr uint32_t dutyOf(int16_t angle){
+        return ((uint64_t) (MIN_WIDTH_US + (int32_t) angle * (MAX_WIDTH_US - MIN_WIDTH_US) / MAX_ANGLE) * ((1 << DUTY_BITS) - 1) * FREQUENCY + 500000) / 1000000;
+    }
+
+    // releaseAngle이 음수면 복귀하지 않음
+    constexpr channel_t channel(uint8_t servoPin, uint8_t touchPin, int16_t onAngle, int16_t offAngle, uint16_t lockout,
+        uint16_t rampTime = 250, uint16_t holdTime = 100, int16_t releaseAngle = -1, uint16_t releaseTime = 0){
+        return {
+            servoPin,
+            touchPin,
+            dutyOf(onAngle),
+            dutyOf(offAngle),
+            lockout,
+            {rampTime, holdTime, releaseAngle < 0 ? 0 : dutyOf(releaseAngle), releaseTime},
+        };
+    }
+
+    // 본인 세팅값, 핀 번호는 XIAO ESP32-S3 기준(GPIO 1은 배터리 측정용)
+    constexpr channel_t CHANNELS[] = {
+#if SWITCH_GANG == 1
+        channel(8, 2, 0, 180, 500),
+#elif SWITCH_GANG == 2
+        channel(8, 2, 0, 180, 500), // 상단
+        channel(9, 3, 180, 0, 1000), // 하단
+#elif SWITCH_GANG == 4
+        channel(8, 2, 0, 180, 500),
+        channel(9, 3, 180, 0, 1000),
+        channel(6, 4, 0, 180, 500),
+        channel(7, 5, 180, 0, 1000),
+#else
+#error "SWITCH_GANG은 1, 2, 4 중 하나여야 합니다."
+#endif
+    };
+}
+
+#define SWITCH_CHANNELS SWITCH_GANG
+
+// 고정 IP, 빌드 시 WIFI_STATIC_IP를 지정하면 DHCP 없이 연결(wifi.h), 주소가 잘못되면 DHCP 사용
+// -D WIFI_STATIC_IP=\"192.168.0.100\" -D WIFI_STATIC_GATEWAY=\"192.168.0.1\" [-D WIFI_STATIC_NETMASK=...] [-D WIFI_STATIC_DNS=...]
+#ifdef WIFI_STATIC_IP
+#ifndef WIFI_STATIC_GATEWAY
+#error "WIFI_STATIC_IP를 지정하면 WIFI_STATIC_GATEWAY도 지정해야 합니다."
+#endif
+#ifndef WIFI_STATIC_NETMASK
+#define WIFI_STATIC_NETMASK "255.255.255.0"
+#endif
+#ifndef WIFI_STATIC_DNS
+#define WIFI_STATIC_DNS WIFI_STATIC_GATEWAY
+#endif
+#endif
+
+static_assert(sizeof(config::CHANNELS) / sizeof(config::CHANNELS[0]) == SWITCH_CHANNELS, "채널 구성표 크기가 SWITCH_GANG과 다름");
+static_assert(config::dutyOf(0) > 0 && config::dutyOf(MAX_ANGLE) < (1 << DUTY_BITS), "duty 범위 초과");
\ No newline at end of file
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <time.h>
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_sleep.h>
+#include <esp_wifi.h>
+#include <esp_timer.h>
+#include <esp32-hal.h>
+#include <esp_websocket_client.h>
+
+#include "logger.h"
+#include "utils.h"
+#include "config.h"
+#include "servo.h"
+#include "touch.h"
+#include "stats.h"
+#include "storage.h"
+#include "reactor.h"
+#include "switches.h"
+#include "schedule.h"
+#include "capture.h"
+#include "outbox.h"
+#include "ota.h"
+#include "websocket.h"
+
+#define DEEP_SLEEP_INTERVAL 3600 // s, 터치, 일정이 없어도 상태 보고를 위해 깨어나는 간격
+#define DEEP_SLEEP_CONNECT_TIMEOUT 15000 // ms, 서버에 연결하지 못해도 이 시간이 지나면 잠듦
+#define DEEP_SLEEP_LINGER 2000 // ms, 보고 후 서버의 명령을 기다리는 시간
+#define DEEP_SLEEP_RETRY 200 // ms, 서보 동작, 전송 대기 중이면 다시 확인
+#define DEEP_SLEEP_CLOSE_TIMEOUT 500 // ms
+#define DEEP_SLEEP_MAGIC 0x44534C50
+
+// POWER_MODE_DEEP_SLEEP: 깨어나면 터치한 채널을 WiFi보다 먼저 구동하고, 서버에 연결해 보고한 뒤 다시 잠듦
+// 스위치 상태, 터치 기준값, 세션 토큰은 RTC 메모리에 유지(AP 정보와 DHCP 임대는 기존대로 NVS에서 읽음)
+// 지연 시간은 esp_timer 기준이라 부트로더 구간이 빠지므로, 타이머로 깨어났을 때 예정 시각과 비교해 그 구간을 추정해 더함
+namespace deepsleep{
+    typedef struct{
+        uint32_t magic;
+        uint32_t wakeCount;
+        uint16_t switchStates;
+        uint32_t switchVersions[SWITCH_CHANNELS]; // 잠들기 전 버전, 깨어나도 이어서 증가
+        uint16_t unreported; // 서버에 보내지 못한 상태 변경(채널 비트), 다음에 연결되면 전송
+        uint8_t padCount;
+        uint32_t touchBaselines[TOUCH_MAX_PADS];
+        uint8_t sessionToken[PROTOCOL_TOKEN_SIZE];
+        uint16_t sessionTtl; // s, 0이면 토큰 없음
+        int64_t sessionExpire; // UNIX s
+        int64_t wakeAt; // us(gettimeofday), 타이머로 깨어날 예정 시각
+        int64_t bootTime; // us, 깨어난 뒤 esp_timer가 시작되기까지 걸린 시간(추정)
+    } retained_t;
+
+    static RTC_DATA_ATTR retained_t retained;
+    static bool restored = false; // deep sleep에서 깨어났고 retained가 유효
+    static int8_t wakeChannel = -1; // 깨운 터치 채널
+    static bool reported = false;
+    static esp_timer_handle_t timer = NULL;
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED; // retained.unreported
+
+    static void timerCallback(void* args){
+        if(!reactor::post(reactor::SLEEP_DUE)){
+            esp_timer_start_once(timer, DEEP_SLEEP_RETRY * 1000ULL);
+        }
+    }
+
+    static void postpone(uint32_t ms){
+        esp_timer_stop(timer);
+        esp_timer_start_once(timer, ms * 1000ULL);
+    }
+
+    // 깨어난 시점부터 현재까지(us)
+    int64_t sinceWake(){
+        return retained.bootTime + esp_timer_get_time();
+    }
+
+    // storage::begin 이후, 스위치 상태를 읽기 전에 호출
+    void begin(){
+        esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+        restored = cause != ESP_SLEEP_WAKEUP_UNDEFINED && retained.magic == DEEP_SLEEP_MAGIC;
+        if(!restored){
+            memset(&retained, 0, sizeof(retained));
+            retained.magic = DEEP_SLEEP_MAGIC;
+        }
+        ++retained.wakeCount;
+        if(restored){
+            storage::setSwitchStates(retained.switchStates); // 잠들기 전에 저장했으므로 보통 같은 값
+        }
+
+        if(cause == ESP_SLEEP_WAKEUP_TIMER && retained.wakeAt > 0){
+            int64_t started = getCurrentMicros() - esp_timer_get_time();
+            retained.bootTime = MAX(started - retained.wakeAt, 0);
+        }else if(cause == ESP_SLEEP_WAKEUP_TOUCHPAD){
+            touch_pad_t pad = esp_sleep_get_touchpad_wakeup_status();
+            for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+                if(digitalPinToTouchChannel(config::CHANNELS[i].touchPin) == pad){
+                    wakeChannel = i;
+                }
+            }
+        }
+
+        esp_timer_create_args_t args = {
+            .callback = timerCallback,
+            .name = "deep_sleep",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+        postpone(DEEP_SLEEP_CONNECT_TIMEOUT);
+        LOG_INFO("[Sleep] %u번째 깨어남, cause: %d, touch: %d, boot: %lldus", retained.wakeCount, cause, wakeChannel, retained.bootTime);
+    }
+
+    // 잠들기 전 스위치 버전, deep sleep에서 깨어난 경우가 아니면 false
+    bool switchVersions(uint32_t* versions){
+        if(!restored){
+            return false;
+        }
+        memcpy(versions, retained.switchVersions, sizeof(retained.switchVersions));
+        return true;
+    }
+
+    // 없으면 NULL(새로 보정)
+    const uint32_t* touchBaselines(){
+        return restored && retained.padCount > 0 ? retained.touchBaselines : NULL;
+    }
+
+    // ws::start 이전에 호출, 남은 토큰으로 세션 재개
+    void restoreSession(){
+        int64_t remaining = retained.sessionExpire - time(NULL);
+        if(restored && retained.sessionTtl > 0 && remaining > 0){
+            ws::importSession(retained.sessionToken, retained.sessionTtl, remaining);
+        }
+    }
+
+    int8_t wakeTouch(){
+        return wakeChannel;
+    }
+
+    // 깨운 터치의 서보 구동 직후 호출
+    void actuated(){
+        int64_t elapsed = sinceWake();
+        stats::add(stats::WAKE_TO_ACTUATION, elapsed);
+        LOG_INFO("[Sleep] wake -> 구동: %lldus", elapsed);
+    }
+
+    // 서버 인증 후 호출, 이전에 깨어났을 때 보내지 못한 채널의 현재 상태를 전송
+    // 이후 전송 대기가 남아 있으면 sleep()이 미루므로 보낸 뒤에 잠듦
+    void reportUnsent(){
+        taskENTER_CRITICAL(&lock);
+        uint16_t channels = retained.unreported;
+        retained.unreported = 0;
+        taskEXIT_CRITICAL(&lock);
+        for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+            if(channels & (1 << i)){
+                ws::sendSwitchState((ledc_channel_t) i);
+            }
+        }
+        if(channels){
+            LOG_INFO("[Sleep] 보내지 못한 상태 변경 전송: 0x%x", channels);
+        }
+    }
+
+    // 서버 인증(보고) 완료, 서버 명령을 잠시 기다린 뒤 잠듦
+    void onReported(){
+        if(reported){
+            return;
+        }
+        reported = true;
+        int64_t elapsed = sinceWake();
+        stats::add(stats::WAKE_TO_REPORT, elapsed);
+        LOG_INFO("[Sleep] wake -> 보고: %lldus", elapsed);
+        postpone(DEEP_SLEEP_LINGER);
+    }
+
+    // SLEEP_DUE마다 deviceTask에서 호출, 진행 중인 작업이 있으면 미룸
+    void sleep(){
+        if(servo::busy() || ota::active() || capture::running || (ws::connectServer && outbox::depth() > 0)){
+            postpone(DEEP_SLEEP_RETRY);
+            return;
+        }
+
+        retained.switchStates = switches::bits();
+        for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+            retained.switchVersions[i] = switches::load(i).version;
+        }
+        taskENTER_CRITICAL(&lock);
+        retained.unreported |= outbox::pendingChannels(); // 서버에 연결되지 않아 남은 전송
+        taskEXIT_CRITICAL(&lock);
+        retained.padCount = touch::padCount;
+        for(uint8_t i = 0; i < touch::padCount; ++i){
+            retained.touchBaselines[i] = touch::baseline(i);
+        }
+        uint32_t remaining = ws::exportSession(retained.sessionToken, retained.sessionTtl);
+        if(remaining == 0){
+            retained.sessionTtl = 0;
+        }
+        retained.sessionExpire = time(NULL) + remaining;
+        storage::setSwitchStates(retained.switchStates);
+        storage::flush();
+
+        // 다음 일정이 더 빠르면 그 시각에 깨어남
+        int64_t seconds = DEEP_SLEEP_INTERVAL;
+        time_t next = schedule::nextDue();
+        if(next > 0){
+            seconds = MIN(seconds, MAX(next - time(NULL), 1));
+        }
+        retained.wakeAt = getCurrentMicros() + seconds * 1000000LL;
+
+        LOG_INFO("[Sleep] %lld초 동안 잠듦, 보내지 못한 변경: 0x%x", seconds, retained.unreported);
+        if(ws::webSocket != NULL && ws::isConnected()){
+            esp_websocket_client_close(ws::webSocket, pdMS_TO_TICKS(DEEP_SLEEP_CLOSE_TIMEOUT));
+        }
+        esp_wifi_stop();
+        vTaskDelay(pdMS_TO_TICKS(20)); // 로그 출력 태스크가 남은 로그를 출력하도록 양보
+
+        // 깨우기 설정은 WiFi를 멈춘 뒤 마지막에 함
+        // esp_wifi_stop이 전원 도메인 설정을 바꿔도 S3 터치 sleep 채널과 RTC 주변장치 전원 유지가 덮어써지지 않음
+        esp_sleep_enable_timer_wakeup(seconds * 1000000ULL);
+        touch::sleepWakeup();
+        esp_deep_sleep_start();
+    }
+}
\ No newline at end of file
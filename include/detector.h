@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+// 터치 판정 알고리즘(호스트에서 빌드 가능), 기기와 native/touch_replay가 같은 코드를 사용
+// 측정값은 터치하면 커지는 방향(ESP32-S3 touchRead 기준)
+
+namespace detector{
+    // 기준값에 비례한 판정 차이(‰), 패드 크기, 배선에 따라 기준값이 달라도 같은 비율로 판단, 기준값이 작으면 minimum
+    inline uint32_t marginOf(uint32_t baseline, uint16_t ratio, uint32_t minimum){
+        uint32_t margin = (uint64_t) baseline * ratio / 1000;
+        return margin < minimum ? minimum : margin;
+    }
+
+    // 폴링 모드의 기존 방식: 부팅 시 평균으로 고정한 기준값 + margin을 넘는 순간을 터치로 판단
+    struct Threshold{
+        uint32_t threshold = 0;
+        uint32_t margin;
+        bool touched = false;
+
+        Threshold(uint32_t margin = 0): margin(margin){}
+
+        // 보정 구간 평균을 100 단위로 내림 + 100
+        void calibrate(uint32_t average){
+            threshold = average / 100 * 100 + 100;
+        }
+
+        uint32_t baseline() const{
+            return threshold;
+        }
+
+        // 새로 눌린 순간이면 true
+        bool update(uint32_t value){
+            if(value > threshold + margin){
+                bool rising = !touched;
+                touched = true;
+                return rising;
+            }
+            touched = false;
+            return false;
+        }
+    };
+
+    // 누르지 않은 동안 기준값이 천천히 따라가는 방식(S3 하드웨어 IIR 필터와 유사), 해제는 히스테리시스 적용
+    // 습도, 온도 변화로 기준값이 움직여도 margin이 유지됨
+    template<uint8_t SHIFT>
+    struct Adaptive{
+        int64_t value = -1; // 기준값 << SHIFT
+        uint32_t margin;
+        uint32_t release; // 기준값 + release 아래로 내려가야 해제
+        uint8_t confirm; // 연속으로 넘어야 하는 측정 수
+        uint8_t count = 0;
+        bool touched = false;
+
+        Adaptive(uint32_t margin, uint32_t release, uint8_t confirm): margin(margin), release(release), confirm(confirm){}
+
+        void calibrate(uint32_t average){
+            value = (int64_t) average << SHIFT;
+        }
+
+        uint32_t baseline() const{
+            return value < 0 ? 0 : value >> SHIFT;
+        }
+
+        bool update(uint32_t sample){
+            if(value < 0){
+                calibrate(sample);
+            }
+            uint32_t base = baseline();
+            if(touched){
+                if(sample < base + release){
+                    touched = false;
+                    count = 0;
+                }
+                return false;
+            }
+            if(sample > base + margin){
+                if(++count >= confirm){
+                    touched = true;
+                    return true;
+                }
+                return false;
+            }
+            count = 0;
+            value += (int64_t) sample - baseline();
+            return false;
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+
+// 정수 연산만 사용하는 측정값 필터(호스트에서 빌드 가능)
+
+using namespace std;
+
+namespace filter{
+    typedef struct{
+        uint16_t mVolt;
+        uint8_t level;
+    } curve_point_t;
+
+    // samples의 순서가 바뀜
+    inline uint16_t median(uint16_t* samples, uint16_t count){
+        if(count == 0){
+            return 0;
+        }
+        nth_element(samples, samples + count / 2, samples + count);
+        return samples[count / 2];
+    }
+
+    // 지수 이동 평균, 계수 = 1 / 2^SHIFT, 소수점 아래 4비트 유지
+    template<uint8_t SHIFT>
+    struct Ema{
+        int32_t value = -1;
+
+        uint16_t update(uint16_t sample){
+            if(value < 0){
+                value = sample << 4;
+            }else{
+                value += ((sample << 4) - value) >> SHIFT;
+            }
+            return value >> 4;
+        }
+    };
+
+    // 전압 오름차순 변환표에서 선형 보간
+    inline uint8_t levelOf(const curve_point_t* curve, uint8_t size, uint16_t mVolt){
+        if(mVolt <= curve[0].mVolt){
+            return curve[0].level;
+        }
+        for(uint8_t i = 1; i < size; ++i){
+            if(mVolt < curve[i].mVolt){
+                const curve_point_t& low = curve[i - 1];
+                const curve_point_t& high = curve[i];
+                return low.level + (mVolt - low.mVolt) * (high.level - low.level) / (high.mVolt - low.mVolt);
+            }
+        }
+        return curve[size - 1].level;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// application/x-www-form-urlencoded 스트리밍 파서(호스트에서 빌드 가능)
+// 나뉘어 도착한 데이터를 순서대로 feed하면 등록한 필드만 고정 버퍼에 바로 디코딩
+// 잘못된 %XX, %00, 버퍼보다 긴 값은 오류로 처리
+
+#define FORM_KEY_SIZE 16
+
+namespace form{
+    typedef struct{
+        const char* name;
+        char* value; // NUL 포함 capacity 바이트
+        uint16_t capacity;
+        uint16_t length;
+        bool found;
+    } field_t;
+
+    class Parser{
+    private:
+        typedef enum{
+            KEY,
+            VALUE,
+            SKIP, // 등록하지 않은 필드의 값
+        } state_t;
+
+        field_t* fields;
+        uint8_t count;
+        field_t* current = NULL;
+        state_t state = KEY;
+        char key[FORM_KEY_SIZE];
+        uint8_t keyLength = 0;
+        uint8_t escape = 0; // '%' 이후 읽은 문자 수 + 1, 0이면 일반 문자
+        uint8_t high = 0;
+        bool error = false;
+
+        static int8_t hexOf(char c){
+            if(c >= '0' && c <= '9'){
+                return c - '0';
+            }
+            c |= 0x20;
+            if(c >= 'a' && c <= 'f'){
+                return c - 'a' + 10;
+            }
+            return -1;
+        }
+
+        field_t* find(){
+            if(keyLength >= FORM_KEY_SIZE){
+                return NULL;
+            }
+            for(uint8_t i = 0; i < count; ++i){
+                if(strlen(fields[i].name) == keyLength && memcmp(fields[i].name, key, keyLength) == 0){
+                    return &fields[i];
+                }
+            }
+            return NULL;
+        }
+
+        void append(char c){
+            if(c == '\0' || current->length + 1 >= current->capacity){
+                error = true;
+                return;
+            }
+            current->value[current->length++] = c;
+            current->value[current->length] = '\0';
+        }
+
+        void value(char c){
+            if(escape > 0){
+                int8_t digit = hexOf(c);
+                if(digit < 0){
+                    error = true;
+                }else if(escape == 1){
+                    high = digit;
+                    escape = 2;
+                }else{
+                    escape = 0;
+                    append((char) (high << 4 | digit));
+                }
+            }else if(c == '%'){
+                escape = 1;
+            }else{
+                append(c == '+' ? ' ' : c);
+            }
+        }
+
+    public:
+        Parser(field_t* fields, uint8_t count): fields(fields), count(count){
+            for(uint8_t i = 0; i < count; ++i){
+                fields[i].length = 0;
+                fields[i].found = false;
+                if(fields[i].capacity > 0){
+                    fields[i].value[0] = '\0';
+                }
+            }
+        }
+
+        // 오류가 발생하면 false, 이후 입력은 무시
+        bool feed(const char* data, size_t length){
+            for(size_t i = 0; i < length && !error; ++i){
+                char c = data[i];
+                if(c == '&'){
+                    if(escape > 0){
+                        error = true;
+                        break;
+                    }
+                    state = KEY;
+                    keyLength = 0;
+                }else if(state == KEY){
+                    if(c != '='){
+                        if(keyLength < FORM_KEY_SIZE){
+                            key[keyLength++] = c;
+                        }
+                        continue;
+                    }
+                    current = find();
+                    state = current == NULL ? SKIP : VALUE;
+                    if(current != NULL){
+                        // 같은 이름이 반복되면 마지막 값을 사용
+                        current->found = true;
+                        current->length = 0;
+                        current->value[0] = '\0';
+                    }
+                }else if(state == VALUE){
+                    value(c);
+                }
+            }
+            return !error;
+        }
+
+        // 입력이 끝난 뒤 호출, 끝나지 않은 %XX가 있으면 false
+        bool finish(){
+            error |= escape > 0;
+            return !error;
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 시간, 난수, 잠금, 타이머, NVS, 터치/ADC 입력 등 하드웨어 의존 기능의 최소 추상화
+// ESP-IDF가 아닌 환경(호스트 빌드)에서는 직접 진행시키는 시뮬레이션 시간, 메모리 NVS, 테스트가 지정한 입력을 사용
+
+#ifdef ESP_PLATFORM
+#include <nvs.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <esp32-hal.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace hal{
+    inline int64_t micros(){
+        return esp_timer_get_time();
+    }
+
+    inline uint32_t random(){
+        return esp_random();
+    }
+
+    inline void delay(uint32_t ms){
+        vTaskDelay(pdMS_TO_TICKS(ms));
+    }
+
+    // 짧은 임계 구역, ISR에서는 사용하지 않음
+    struct Lock{
+        portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+        void lock(){
+            taskENTER_CRITICAL(&mux);
+        }
+
+        void unlock(){
+            taskEXIT_CRITICAL(&mux);
+        }
+    };
+
+    // 한 번 실행되는 타이머, 콜백은 esp_timer 태스크에서 실행
+    struct Timer{
+        esp_timer_handle_t handle = NULL;
+
+        bool create(esp_timer_cb_t callback, const char* name){
+            if(handle != NULL){
+                return true;
+            }
+            esp_timer_create_args_t args = {
+                .callback = callback,
+                .name = name,
+            };
+            return esp_timer_create(&args, &handle) == ESP_OK;
+        }
+
+        bool created() const{
+            return handle != NULL;
+        }
+
+        void once(uint64_t us){
+            esp_timer_start_once(handle, us);
+        }
+
+        void stop(){
+            esp_timer_stop(handle);
+        }
+
+        bool active() const{
+            return esp_timer_is_active(handle);
+        }
+    };
+
+    // NVS 네임스페이스 하나, get의 length는 버퍼 크기를 받고 저장된 크기를 돌려줌
+    struct Nvs{
+        nvs_handle_t handle = 0;
+
+        bool open(const char* name){
+            return nvs_open(name, NVS_READWRITE, &handle) == ESP_OK;
+        }
+
+        bool getBlob(const char* key, void* data, size_t* length){
+            return nvs_get_blob(handle, key, data, length) == ESP_OK;
+        }
+
+        bool setBlob(const char* key, const void* data, size_t length){
+            return nvs_set_blob(handle, key, data, length) == ESP_OK;
+        }
+
+        bool getString(const char* key, char* data, size_t* length){
+            return nvs_get_str(handle, key, data, length) == ESP_OK;
+        }
+
+        bool setString(const char* key, const char* data){
+            return nvs_set_str(handle, key, data) == ESP_OK;
+        }
+
+        void erase(const char* key){
+            nvs_erase_key(handle, key);
+        }
+
+        bool commit(){
+            return nvs_commit(handle) == ESP_OK;
+        }
+    };
+
+    // 터치 센서 측정값(터치하면 커짐)
+    inline uint32_t touchRead(uint8_t pin){
+        return ::touchRead(pin);
+    }
+}
+#else
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <string.h>
+
+namespace hal{
+    inline std::atomic<int64_t>& clock(){
+        static std::atomic<int64_t> now(0);
+        return now;
+    }
+
+    inline int64_t micros(){
+        return clock().load(std::memory_order_relaxed);
+    }
+
+    inline void setMicros(int64_t now){
+        clock().store(now, std::memory_order_relaxed);
+    }
+
+    // xorshift32, 재현 가능한 결과를 위해 고정 시드
+    inline uint32_t random(){
+        static uint32_t state = 2463534242u;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    struct Lock{
+        std::mutex mutex;
+
+        void lock(){
+            mutex.lock();
+        }
+
+        void unlock(){
+            mutex.unlock();
+        }
+    };
+
+    // 시뮬레이션 시간이 만료 시각을 지나면 advance()를 호출한 스레드에서 바로 실행(타이머는 한 스레드에서만 사용)
+    struct Timer;
+
+    inline std::vector<Timer*>& timers(){
+        static std::vector<Timer*> list;
+        return list;
+    }
+
+    struct Timer{
+        void (*callback)(void*) = NULL;
+        int64_t deadline = -1; // us, -1이면 정지
+
+        bool create(void (*function)(void*), const char* name){
+            if(callback == NULL){
+                timers().push_back(this);
+            }
+            callback = function;
+            return true;
+        }
+
+        bool created() const{
+            return callback != NULL;
+        }
+
+        void once(uint64_t us){
+            deadline = micros() + us;
+        }
+
+        void stop(){
+            deadline = -1;
+        }
+
+        bool active() const{
+            return deadline >= 0;
+        }
+    };
+
+    // 만료된 타이머를 만료 순서대로 실행, 콜백이 다시 예약해도 지금 시각 이후면 다음 advance에서 실행
+    inline void runTimers(){
+        for(;;){
+            Timer* next = NULL;
+            for(Timer* timer : timers()){
+                if(timer->active() && timer->deadline <= micros() && (next == NULL || timer->deadline < next->deadline)){
+                    next = timer;
+                }
+            }
+            if(next == NULL){
+                return;
+            }
+            next->deadline = -1;
+            next->callback(NULL);
+        }
+    }
+
+    inline void advance(int64_t elapsed){
+        clock().fetch_add(elapsed, std::memory_order_relaxed);
+        if(!timers().empty()){
+            runTimers();
+        }
+    }
+
+    inline void delay(uint32_t ms){
+        advance(ms * 1000LL);
+    }
+
+    // 메모리 NVS("네임스페이스/키" -> 값), 재부팅을 흉내 낼 때는 그대로 두고 모듈만 다시 시작
+    inline std::map<std::string, std::vector<uint8_t>>& flash(){
+        static std::map<std::string, std::vector<uint8_t>> entries;
+        return entries;
+    }
+
+    // true면 쓰기와 commit이 실패(저장 실패 처리 확인용)
+    inline bool& flashFailing(){
+        static bool failing = false;
+        return failing;
+    }
+
+    struct Nvs{
+        std::string prefix;
+
+        bool open(const char* name){
+            prefix = std::string(name) + "/";
+            return true;
+        }
+
+        bool getBlob(const char* key, void* data, size_t* length){
+            auto entry = flash().find(prefix + key);
+            if(entry == flash().end() || entry->second.size() > *length){
+                return false;
+            }
+            memcpy(data, entry->second.data(), entry->second.size());
+            *length = entry->second.size();
+            return true;
+        }
+
+        bool setBlob(const char* key, const void* data, size_t length){
+            if(flashFailing()){
+                return false;
+            }
+            const uint8_t* bytes = (const uint8_t*) data;
+            flash()[prefix + key].assign(bytes, bytes + length);
+            return true;
+        }
+
+        bool getString(const char* key, char* data, size_t* length){
+            return getBlob(key, data, length);
+        }
+
+        bool setString(const char* key, const char* data){
+            return setBlob(key, data, strlen(data) + 1);
+        }
+
+        void erase(const char* key){
+            flash().erase(prefix + key);
+        }
+
+        bool commit(){
+            return !flashFailing();
+        }
+    };
+
+    // 핀별 터치 측정값, 테스트가 지정
+    inline uint32_t& touchValue(uint8_t pin){
+        static uint32_t values[64] = {0};
+        return values[pin & 63];
+    }
+
+    inline uint32_t touchRead(uint8_t pin){
+        return touchValue(pin);
+    }
+
+    // battery.h가 한 번에 읽는 ADC 원시값, 테스트가 지정(비어 있으면 측정 실패)
+    inline std::vector<uint16_t>& adcSamples(){
+        static std::vector<uint16_t> samples;
+        return samples;
+    }
+
+    inline uint16_t adcRead(uint16_t* samples, uint16_t capacity){
+        uint16_t count = 0;
+        for(; count < capacity && count < adcSamples().size(); ++count){
+            samples[count] = adcSamples()[count];
+        }
+        return count;
+    }
+}
+#endif
+
+namespace hal{
+    inline int64_t millis(){
+        return micros() / 1000;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <string.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <lwip/sockets.h>
+#include <mbedtls/md.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#if __has_include(<mdns.h>)
+#include <mdns.h>
+#define LAN_MDNS 1
+#endif
+
+#include "logger.h"
+#include "config.h"
+#include "storage.h"
+#include "protocol.h"
+
+// 같은 네트워크의 제어기가 서버를 거치지 않고 UDP로 명령을 보내는 경로
+// LAN_KEY(공유 비밀키)를 빌드 플래그로 지정했을 때만 동작, 예: -D LAN_KEY=\"...\"
+// 모든 프레임(HELLO 제외)은 HMAC-SHA256(앞 16바이트)으로 인증
+// 부팅마다 새 세션 번호를 쓰고 세션 안에서 counter는 증가해야 함(재전송 방지)
+
+#define LAN_PORT 40000
+#define LAN_MAC_SIZE 16
+#define LAN_FRAME_SIZE 128
+
+using namespace std;
+
+namespace lan{
+    typedef enum{
+        HELLO = 0xA0, // [type][client nonce(u32)], 인증 없음
+        HELLO_ACK = 0xA1, // [type][client nonce(u32)][session(u32)][last counter(u32)][mac]
+        REQUEST = 0xA2, // [type][session(u32)][counter(u32)][protocol 프레임][mac]
+        RESPONSE = 0xA3, // [type][session(u32)][counter(u32)][protocol 프레임][mac], ACK_V2의 time은 수락 시각(서보 이동 전)
+    } frame_type_t;
+
+    // 명령을 반영하고 결과를 반환, main.cpp에서 지정
+    typedef protocol::ack_status_t (*command_handler_t)(const protocol::command_t& command, int64_t received);
+
+    atomic<uint32_t> acceptCount = 0;
+    atomic<uint32_t> rejectCount = 0;
+
+#ifdef LAN_KEY
+    static command_handler_t handler = NULL;
+    static uint32_t session = 0;
+    static uint32_t lastCounter = 0;
+
+    static bool sign(const uint8_t* data, size_t length, uint8_t* mac){
+        uint8_t full[32];
+        if(mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t*) LAN_KEY, strlen(LAN_KEY), data, length, full) != 0){
+            return false;
+        }
+        memcpy(mac, full, LAN_MAC_SIZE);
+        return true;
+    }
+
+    // 비교 시간이 내용에 따라 달라지지 않도록 끝까지 비교
+    static bool verify(const uint8_t* data, size_t length){
+        uint8_t mac[LAN_MAC_SIZE];
+        if(length <= LAN_MAC_SIZE || !sign(data, length - LAN_MAC_SIZE, mac)){
+            return false;
+        }
+        uint8_t diff = 0;
+        for(uint8_t i = 0; i < LAN_MAC_SIZE; ++i){
+            diff |= mac[i] ^ data[length - LAN_MAC_SIZE + i];
+        }
+        return diff == 0;
+    }
+
+    static bool seal(protocol::Writer& writer){
+        uint8_t* mac = writer.reserve(LAN_MAC_SIZE);
+        return mac != NULL && sign(writer.buffer, writer.length - LAN_MAC_SIZE, mac);
+    }
+
+    // 응답할 프레임을 writer에 기록, 응답하지 않으면 false
+    static bool process(const uint8_t* data, uint16_t length, protocol::Writer& writer){
+        int64_t received = esp_timer_get_time();
+        protocol::Reader reader(data, length);
+        uint8_t type = reader.u8();
+        if(type == HELLO){
+            uint32_t nonce = reader.u32();
+            if(!reader.done()){
+                return false;
+            }
+            writer.u8(HELLO_ACK);
+            writer.u32(nonce);
+            writer.u32(session);
+            writer.u32(lastCounter);
+            return seal(writer);
+        }
+
+        if(type != REQUEST || length <= 9 + LAN_MAC_SIZE || !verify(data, length)){
+            return false;
+        }
+        uint32_t requestSession = reader.u32();
+        uint32_t counter = reader.u32();
+        if(reader.error || requestSession != session || counter <= lastCounter){
+            return false;
+        }
+        lastCounter = counter;
+
+        const uint8_t* payload = data + 9;
+        uint16_t payloadLength = length - 9 - LAN_MAC_SIZE;
+        protocol::command_t command;
+        if(payloadLength == 0 || payload[0] != protocol::COMMAND_V2 || !protocol::decodeCommand(payload, payloadLength, command)){
+            return false;
+        }
+        // 응답은 바로 보내므로 서보 이동 시각이 아니라 스위치 상태에 반영한 시각(수락 시각)
+        // 서보는 이후 deviceTask가 움직이고, 실제 이동 시각은 웹소켓 ACK_V2로만 알 수 있음
+        protocol::ack_status_t status = handler(command, received);
+        uint64_t accepted = esp_timer_get_time();
+        protocol::ack_t ack = {
+            .sequence = command.sequence,
+            .status = (uint8_t) status,
+            .time = accepted,
+        };
+        writer.u8(RESPONSE);
+        writer.u32(session);
+        writer.u32(counter);
+        return protocol::encodeAck(writer, ack) && seal(writer);
+    }
+
+    static void lanTask(void* args){
+        int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(LAN_PORT);
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        if(sock < 0 || bind(sock, (sockaddr*) &address, sizeof(address)) < 0){
+            LOG_ERROR("[LAN] 소켓을 열지 못했습니다.");
+            vTaskDelete(NULL);
+            return;
+        }
+
+        uint8_t request[LAN_FRAME_SIZE];
+        uint8_t response[LAN_FRAME_SIZE];
+        for(;;){
+            sockaddr_in source;
+            socklen_t sourceLength = sizeof(source);
+            int length = recvfrom(sock, request, sizeof(request), 0, (sockaddr*) &source, &sourceLength);
+            if(length <= 0){
+                continue;
+            }
+
+            protocol::Writer writer(response, sizeof(response));
+            if(process(request, length, writer)){
+                ++acceptCount;
+                sendto(sock, response, writer.length, 0, (sockaddr*) &source, sourceLength);
+            }else{
+                ++rejectCount;
+            }
+        }
+    }
+#endif
+
+    // WiFi 연결 후 mDNS로 _switchbot._udp 서비스 광고
+    void advertise(){
+#if defined(LAN_KEY) && defined(LAN_MDNS)
+        static bool started = false;
+        if(started || mdns_init() != ESP_OK){
+            return;
+        }
+        started = true;
+
+        const char* device = storage::getDeviceId();
+        char hostname[24] = "switchbot-";
+        strlcat(hostname, device + 6, sizeof(hostname)); // 기기 ID의 숫자 부분
+        char channels[4];
+        snprintf(channels, sizeof(channels), "%d", SWITCH_CHANNELS);
+        mdns_txt_item_t txt[] = {
+            {"id", device},
+            {"ch", channels},
+        };
+        mdns_hostname_set(hostname);
+        mdns_service_add(device, "_switchbot", "_udp", LAN_PORT, txt, 2);
+        LOG_INFO("[LAN] mDNS: %s.local", logger::Text(hostname));
+#endif
+    }
+
+    void start(command_handler_t commandHandler){
+#ifdef LAN_KEY
+        handler = commandHandler;
+        session = esp_random();
+        xTaskCreate(lanTask, "lan", 4096, NULL, 2, NULL);
+#endif
+    }
+}
\ No newline at end of file
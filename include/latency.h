@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#define LATENCY_SUB_BITS 2 // 2의 거듭제곱 구간을 4개로 나눔(오차 25% 이하)
+#define LATENCY_BUCKETS ((32 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+using namespace std;
+
+namespace latency{
+    // 고정 메모리 로그 스케일 히스토그램(단위: us)
+    struct Histogram{
+        atomic<uint32_t> buckets[LATENCY_BUCKETS];
+        atomic<uint32_t> count;
+        atomic<uint32_t> max;
+
+        static uint8_t indexOf(uint32_t value){
+            if(value < (1 << LATENCY_SUB_BITS)){
+                return value;
+            }
+            uint8_t msb = 31 - __builtin_clz(value);
+            uint8_t sub = (value >> (msb - LATENCY_SUB_BITS)) & ((1 << LATENCY_SUB_BITS) - 1);
+            return ((msb - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS) + sub;
+        }
+
+        // 버킷이 포함하는 값의 상한
+        static uint32_t upperOf(uint8_t index){
+            if(index < (1 << LATENCY_SUB_BITS)){
+                return index;
+            }
+            uint8_t msb = (index >> LATENCY_SUB_BITS) + LATENCY_SUB_BITS - 1;
+            uint64_t lower = (1ULL << msb) | ((uint64_t) (index & ((1 << LATENCY_SUB_BITS) - 1)) << (msb - LATENCY_SUB_BITS));
+            return (uint32_t) (lower + (1ULL << (msb - LATENCY_SUB_BITS)) - 1);
+        }
+
+        void record(uint32_t value){
+            buckets[indexOf(value)].fetch_add(1, memory_order_relaxed);
+            count.fetch_add(1, memory_order_relaxed);
+            uint32_t last = max.load(memory_order_relaxed);
+            while(value > last && !max.compare_exchange_weak(last, value, memory_order_relaxed));
+        }
+
+        // permille: 500 = p50, 990 = p99
+        uint32_t percentile(uint16_t permille) const{
+            uint32_t total = count.load(memory_order_relaxed);
+            if(total == 0){
+                return 0;
+            }
+            uint64_t rank = ((uint64_t) total * permille + 999) / 1000;
+            uint64_t seen = 0;
+            for(uint8_t i = 0; i < LATENCY_BUCKETS; ++i){
+                seen += buckets[i].load(memory_order_relaxed);
+                if(seen >= rank){
+                    uint32_t upper = upperOf(i);
+                    uint32_t top = max.load(memory_order_relaxed);
+                    return upper < top ? upper : top;
+                }
+            }
+            return max.load(memory_order_relaxed);
+        }
+
+        void reset(){
+            for(uint8_t i = 0; i < LATENCY_BUCKETS; ++i){
+                buckets[i].store(0, memory_order_relaxed);
+            }
+            count.store(0, memory_order_relaxed);
+            max.store(0, memory_order_relaxed);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <atomic>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "ring.h"
+
+// 호출한 태스크에서는 포맷 주소와 인자만 링 버퍼에 넣고, 문자열 변환과 출력은 낮은 우선순위의 태스크가 처리
+// 포맷 문자열은 리터럴이어야 함(주소가 곧 포맷 ID), 호스트에서 빌드 가능
+// LOG_INFO("[Servo] %d번 스위치 %s", channel, state ? "켜짐" : "꺼짐");
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO // 이보다 높은 레벨은 컴파일되지 않음
+#endif
+
+#define LOG_QUEUE_SIZE 32 // 대기 가능한 레코드 수(2의 거듭제곱)
+#define LOG_MAX_ARGS 4
+#define LOG_TEXT_SIZE 24 // logger::Text로 복사하는 문자열 최대 길이(NULL 포함)
+#define LOG_LINE_SIZE 192
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logger::write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void) 0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logger::write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void) 0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logger::write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void) 0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logger::write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void) 0)
+#endif
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+using namespace std;
+
+namespace logger{
+    // 출력 전에 사라질 수 있는 문자열(수신 버퍼, 지역 변수)은 Text로 감싸 레코드에 복사, 레코드당 하나
+    struct Text{
+        const char* data;
+        size_t length;
+
+        Text(const char* data): data(data), length(strlen(data)){}
+        Text(const char* data, size_t length): data(data), length(length){}
+    };
+
+    typedef struct{
+        const char* format;
+        uint8_t level;
+        uint8_t count;
+        uint64_t args[LOG_MAX_ARGS]; // 정수는 부호 확장, 실수는 비트 그대로, 문자열은 주소
+        char text[LOG_TEXT_SIZE];
+    } record_t;
+
+    static Ring<record_t, LOG_QUEUE_SIZE> queue;
+    atomic<uint32_t> dropCount = 0;
+
+#ifdef ESP_PLATFORM
+    static TaskHandle_t task = NULL;
+#endif
+
+    template<typename T>
+    inline typename enable_if<is_integral<T>::value || is_enum<T>::value>::type store(record_t& record, uint8_t index, T value){
+        record.args[index] = (uint64_t) (int64_t) value;
+    }
+
+    template<typename T>
+    inline typename enable_if<is_floating_point<T>::value>::type store(record_t& record, uint8_t index, T value){
+        double number = value;
+        memcpy(&record.args[index], &number, sizeof(number));
+    }
+
+    inline void store(record_t& record, uint8_t index, const char* value){
+        record.args[index] = (uintptr_t) value;
+    }
+
+    inline void store(record_t& record, uint8_t index, const Text& value){
+        size_t length = value.length < LOG_TEXT_SIZE ? value.length : LOG_TEXT_SIZE - 1;
+        memcpy(record.text, value.data, length);
+        record.text[length] = '\0';
+        record.args[index] = (uintptr_t) record.text;
+    }
+
+    inline void wake(){
+#ifdef ESP_PLATFORM
+        if(task != NULL){
+            xTaskNotifyGive(task);
+        }
+#endif
+    }
+
+    // 호출한 태스크를 막지 않음, 버퍼가 가득 찼으면 버리고 개수만 셈
+    template<typename... Args>
+    inline void write(uint8_t level, const char* format, const Args&... args){
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "로그 인자 수 초과");
+        bool pushed = queue.emplace([&](record_t& record){
+            record.format = format;
+            record.level = level;
+            record.count = sizeof...(Args);
+            uint8_t index = 0;
+            (void) index;
+            (store(record, index++, args), ...);
+        });
+        if(!pushed){
+            dropCount.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        wake();
+    }
+
+    // 변환 하나를 printf로 처리, 길이 수식어(l, ll, z 등)는 무시하고 64비트 값으로 출력
+    static int formatArg(char* out, size_t size, const char* spec, size_t specLength, char conversion, uint64_t value){
+        char format[16];
+        memcpy(format, spec, specLength);
+        switch(conversion){
+            case 'd':
+            case 'i':
+                memcpy(format + specLength, "ll", 2);
+                format[specLength + 2] = conversion;
+                format[specLength + 3] = '\0';
+                return snprintf(out, size, format, (long long) value);
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                memcpy(format + specLength, "ll", 2);
+                format[specLength + 2] = conversion;
+                format[specLength + 3] = '\0';
+                return snprintf(out, size, format, (unsigned long long) value);
+            case 'c':
+                format[specLength] = conversion;
+                format[specLength + 1] = '\0';
+                return snprintf(out, size, format, (int) value);
+            case 's':{
+                format[specLength] = conversion;
+                format[specLength + 1] = '\0';
+                const char* text = (const char*) (uintptr_t) value;
+                return snprintf(out, size, format, text == NULL ? "(null)" : text);
+            }
+            case 'p':
+                format[specLength] = conversion;
+                format[specLength + 1] = '\0';
+                return snprintf(out, size, format, (void*) (uintptr_t) value);
+            case 'f':
+            case 'e':
+            case 'g':{
+                double number;
+                memcpy(&number, &value, sizeof(number));
+                format[specLength] = conversion;
+                format[specLength + 1] = '\0';
+                return snprintf(out, size, format, number);
+            }
+        }
+        return 0;
+    }
+
+    // 레코드를 한 줄로 변환, 줄바꿈 포함 길이 반환(잘리면 size - 1)
+    static size_t format(const record_t& record, char* out, size_t size){
+        size_t length = 0;
+        uint8_t index = 0;
+        const char* position = record.format;
+        while(*position != '\0' && length + 2 < size){
+            if(*position != '%'){
+                out[length++] = *position++;
+                continue;
+            }
+            if(position[1] == '%'){
+                out[length++] = '%';
+                position += 2;
+                continue;
+            }
+
+            const char* spec = position++;
+            while(*position != '\0' && strchr("-+ #0123456789.", *position) != NULL && position - spec < 10){
+                ++position;
+            }
+            size_t specLength = position - spec;
+            while(*position != '\0' && strchr("hlLjzt", *position) != NULL){
+                ++position;
+            }
+            char conversion = *position;
+            if(conversion == '\0'){
+                break;
+            }
+            ++position;
+
+            uint64_t value = index < record.count ? record.args[index++] : 0;
+            int written = formatArg(out + length, size - 1 - length, spec, specLength, conversion, value);
+            if(written > 0){
+                length += (size_t) written < size - 1 - length ? written : size - 2 - length;
+            }
+        }
+        out[length++] = '\n';
+        out[length] = '\0';
+        return length;
+    }
+
+    // 쌓인 레코드를 모두 출력, 출력 태스크 또는 호스트에서 호출
+    void drain(FILE* out){
+        char line[LOG_LINE_SIZE];
+        for(record_t* record = queue.front(); record != NULL; record = queue.front()){
+            format(*record, line, sizeof(line));
+            queue.pop();
+            fputs(line, out);
+        }
+        uint32_t dropped = dropCount.exchange(0, memory_order_relaxed);
+        if(dropped > 0){
+            fprintf(out, "[Log] 버퍼가 가득 차 %u개를 버렸습니다.\n", (unsigned) dropped);
+        }
+    }
+
+#ifdef ESP_PLATFORM
+    static void drainTask(void* args){
+        for(;;){
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            drain(stdout);
+        }
+    }
+
+    // 다른 모듈보다 먼저 호출, 이전에 쌓인 로그도 출력됨
+    void begin(){
+        if(task == NULL){
+            xTaskCreate(drainTask, "log", 3072, NULL, tskIDLE_PRIORITY, &task);
+            xTaskNotifyGive(task);
+        }
+    }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <esp_timer.h>
+#include <esp_ota_ops.h>
+#include <esp_app_desc.h>
+#include <esp_system.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/md.h>
+#include <rom/miniz.h>
+
+#include "logger.h"
+#include "power.h"
+#include "outbox.h"
+#include "protocol.h"
+
+// 웹소켓 세션으로 zlib 압축 이미지를 받아 푸는 동시에 비활성 OTA 파티션에 기록
+// 새 이미지는 서버 인증(connectServer)까지 도달해야 확정되고, 그 전에 재부팅되거나
+// OTA_VERIFY_TIMEOUT이 지나면 부트로더가 이전 이미지로 되돌림(BOOTLOADER_APP_ROLLBACK_ENABLE)
+// 웹소켓은 평문이므로 OTA_BEGIN_V2는 OTA_KEY(공유 비밀키, 없으면 LAN_KEY)로 서명해야 하고, 키 없이 빌드하면 OTA를 받지 않음
+// 서명에 이미지 sha256이 포함되므로 OTA_END_V2에서 해시가 맞으면 이미지 전체가 인증됨
+// 서명에는 현재 세션 토큰(SESSION_V2)도 포함되어 다른 세션에서 기록한 OTA_BEGIN_V2를 다시 보내도 거부되고,
+// 이미지 버전(esp_app_desc_t)이 실행 중인 버전보다 높아야 부팅 파티션을 바꾸므로 이전 이미지로 되돌릴 수 없음
+
+#define OTA_VERIFY_TIMEOUT 300000 // 새 이미지가 서버에 연결되어야 하는 시간(ms)
+#define OTA_RESTART_DELAY 1000 // 완료 응답 전송 후 재부팅까지 대기(ms)
+
+#if !defined(OTA_KEY) && defined(LAN_KEY)
+#define OTA_KEY LAN_KEY
+#endif
+
+using namespace std;
+
+namespace ota{
+    static esp_ota_handle_t otaHandle = 0;
+    static const esp_partition_t* partition = NULL;
+    static tinfl_decompressor* decompressor = NULL;
+    static uint8_t* window = NULL; // 압축 해제 출력 겸 사전(TINFL_LZ_DICT_SIZE)
+    static uint32_t windowOffset = 0;
+    static mbedtls_sha256_context sha;
+    static protocol::ota_begin_t target;
+    static uint32_t received = 0;
+    static uint32_t written = 0;
+    static bool finished = false; // 압축 스트림 끝(TINFL_STATUS_DONE)
+    static esp_timer_handle_t timer = NULL;
+    static bool (*getSession)(uint8_t* token) = NULL; // 현재 세션 토큰, 없으면 false
+
+    bool active(){
+        return decompressor != NULL;
+    }
+
+    static void report(uint16_t sequence, protocol::ota_status_t status){
+        protocol::ota_report_t report = {
+            .sequence = sequence,
+            .status = (uint8_t) status,
+            .received = received,
+        };
+        uint8_t buffer[16];
+        protocol::Writer writer(buffer, sizeof(buffer));
+        if(protocol::encodeOtaStatus(writer, report)){
+            outbox::push(buffer, writer.length);
+        }
+    }
+
+    static void release(){
+        mbedtls_sha256_free(&sha);
+        free(decompressor);
+        free(window);
+        decompressor = NULL;
+        window = NULL;
+        power::release(power::OTA);
+    }
+
+    // 진행 중인 OTA를 취소, 소켓 연결이 끊어지면 처음부터 다시 받음
+    void abort(){
+        if(!active()){
+            return;
+        }
+        if(otaHandle != 0){
+            esp_ota_abort(otaHandle);
+            otaHandle = 0;
+        }
+        release();
+        LOG_WARN("[OTA] 취소되었습니다.");
+    }
+
+    // frame: OTA_BEGIN_V2 전체, 마지막 PROTOCOL_OTA_MAC_SIZE 바이트가 서명(앞부분 + 세션 토큰의 HMAC)
+    // 세션 토큰이 없으면 거부
+    static bool authentic(const uint8_t* frame, uint16_t length){
+#ifdef OTA_KEY
+        uint8_t token[PROTOCOL_TOKEN_SIZE];
+        if(length <= PROTOCOL_OTA_MAC_SIZE || getSession == NULL || !getSession(token)){
+            return false;
+        }
+        uint8_t mac[32];
+        mbedtls_md_context_t context;
+        mbedtls_md_init(&context);
+        bool hashed = mbedtls_md_setup(&context, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) == 0
+            && mbedtls_md_hmac_starts(&context, (const uint8_t*) OTA_KEY, strlen(OTA_KEY)) == 0
+            && mbedtls_md_hmac_update(&context, frame, length - PROTOCOL_OTA_MAC_SIZE) == 0
+            && mbedtls_md_hmac_update(&context, token, sizeof(token)) == 0
+            && mbedtls_md_hmac_finish(&context, mac) == 0;
+        mbedtls_md_free(&context);
+        if(!hashed){
+            return false;
+        }
+        // 비교 시간이 내용에 따라 달라지지 않도록 끝까지 비교
+        uint8_t diff = 0;
+        for(uint8_t i = 0; i < PROTOCOL_OTA_MAC_SIZE; ++i){
+            diff |= mac[i] ^ frame[length - PROTOCOL_OTA_MAC_SIZE + i];
+        }
+        return diff == 0;
+#else
+        return false;
+#endif
+    }
+
+    static protocol::ota_status_t begin(const protocol::ota_begin_t& request){
+        if(active()){
+            return protocol::OTA_BUSY;
+        }
+        partition = esp_ota_get_next_update_partition(NULL);
+        if(partition == NULL || request.imageSize == 0 || request.imageSize > partition->size){
+            return protocol::OTA_INVALID;
+        }
+
+        decompressor = (tinfl_decompressor*) malloc(sizeof(tinfl_decompressor));
+        window = (uint8_t*) malloc(TINFL_LZ_DICT_SIZE);
+        if(decompressor == NULL || window == NULL){
+            free(decompressor);
+            free(window);
+            decompressor = NULL;
+            window = NULL;
+            return protocol::OTA_BUSY;
+        }
+        // 섹터 단위로 지우면서 기록, 3MB를 한 번에 지우느라 소켓이 멈추지 않도록 함
+        if(esp_ota_begin(partition, OTA_WITH_SEQUENTIAL_WRITES, &otaHandle) != ESP_OK){
+            free(decompressor);
+            free(window);
+            decompressor = NULL;
+            window = NULL;
+            return protocol::OTA_FLASH_ERROR;
+        }
+
+        power::acquire(power::OTA);
+        tinfl_init(decompressor);
+        mbedtls_sha256_init(&sha);
+        mbedtls_sha256_starts(&sha, 0);
+        target = request;
+        windowOffset = 0;
+        received = 0;
+        written = 0;
+        finished = false;
+        LOG_INFO("[OTA] 시작, image: %u, compressed: %u, partition: %s", request.imageSize, request.compressedSize, partition->label);
+        return protocol::OTA_READY;
+    }
+
+    static protocol::ota_status_t write(const protocol::ota_data_t& chunk){
+        if(!active()){
+            return protocol::OTA_INVALID;
+        }
+        if(chunk.offset != received || received + chunk.length > target.compressedSize || finished){
+            return protocol::OTA_INVALID;
+        }
+        received += chunk.length;
+
+        const uint8_t* input = chunk.data;
+        size_t remaining = chunk.length;
+        uint32_t flags = TINFL_FLAG_PARSE_ZLIB_HEADER | (received < target.compressedSize ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+        for(;;){
+            size_t inputSize = remaining;
+            size_t outputSize = TINFL_LZ_DICT_SIZE - windowOffset;
+            tinfl_status status = tinfl_decompress(decompressor, input, &inputSize, window, window + windowOffset, &outputSize, flags);
+            input += inputSize;
+            remaining -= inputSize;
+
+            if(outputSize > 0){
+                if(written + outputSize > target.imageSize){
+                    return protocol::OTA_INVALID;
+                }
+                if(esp_ota_write(otaHandle, window + windowOffset, outputSize) != ESP_OK){
+                    return protocol::OTA_FLASH_ERROR;
+                }
+                mbedtls_sha256_update(&sha, window + windowOffset, outputSize);
+                written += outputSize;
+                windowOffset = (windowOffset + outputSize) & (TINFL_LZ_DICT_SIZE - 1);
+            }
+
+            if(status < TINFL_STATUS_DONE){
+                return protocol::OTA_INVALID;
+            }else if(status == TINFL_STATUS_DONE){
+                finished = true;
+                break;
+            }else if(status == TINFL_STATUS_NEEDS_MORE_INPUT){
+                if(remaining == 0){
+                    break;
+                }else if(inputSize == 0){
+                    return protocol::OTA_INVALID; // 진행하지 못함
+                }
+            }
+        }
+        return protocol::OTA_PROGRESS;
+    }
+
+    // 숫자 부분은 수로, 나머지는 문자로 비교("v1.10.0" > "v1.9.3"), a가 높으면 양수
+    static int compareVersion(const char* a, const char* b){
+        while(*a != '\0' || *b != '\0'){
+            if(isdigit((unsigned char) *a) && isdigit((unsigned char) *b)){
+                char* end;
+                unsigned long x = strtoul(a, &end, 10);
+                a = end;
+                unsigned long y = strtoul(b, &end, 10);
+                b = end;
+                if(x != y){
+                    return x < y ? -1 : 1;
+                }
+            }else if(*a != *b){
+                return (unsigned char) *a - (unsigned char) *b;
+            }else{
+                ++a;
+                ++b;
+            }
+        }
+        return 0;
+    }
+
+    static void restart(void* args){
+        esp_restart();
+    }
+
+    static protocol::ota_status_t end(){
+        if(!active()){
+            return protocol::OTA_INVALID;
+        }
+        if(!finished || written != target.imageSize || received != target.compressedSize){
+            return protocol::OTA_INVALID;
+        }
+        uint8_t hash[32];
+        mbedtls_sha256_finish(&sha, hash);
+        if(memcmp(hash, target.sha256, sizeof(hash)) != 0){
+            return protocol::OTA_HASH_MISMATCH;
+        }
+        esp_err_t err = esp_ota_end(otaHandle);
+        otaHandle = 0;
+        if(err != ESP_OK){
+            return protocol::OTA_FLASH_ERROR;
+        }
+        // 서명된 이미지라도 같거나 낮은 버전이면 거부(이전에 서명된 이미지 재전송)
+        esp_app_desc_t description;
+        if(esp_ota_get_partition_description(partition, &description) != ESP_OK){
+            return protocol::OTA_INVALID;
+        }
+        const char* running = esp_app_get_description()->version;
+        if(compareVersion(description.version, running) <= 0){
+            LOG_WARN("[OTA] 이미지 버전 %s이 실행 중인 버전 %s보다 높지 않습니다.", logger::Text(description.version), logger::Text(running));
+            return protocol::OTA_DOWNGRADE;
+        }
+        if(esp_ota_set_boot_partition(partition) != ESP_OK){
+            return protocol::OTA_FLASH_ERROR;
+        }
+        return protocol::OTA_DONE;
+    }
+
+    // 웹소켓 수신 프레임 중 OTA 프레임을 처리했으면 true
+    bool handle(const uint8_t* frame, uint16_t length){
+        if(length == 0 || frame[0] < protocol::OTA_BEGIN_V2 || frame[0] > protocol::OTA_END_V2){
+            return false;
+        }
+
+        uint16_t sequence = 0;
+        protocol::ota_status_t status = protocol::OTA_INVALID;
+        if(frame[0] == protocol::OTA_BEGIN_V2){
+            protocol::ota_begin_t request;
+            if(protocol::decodeOtaBegin(frame, length, request)){
+                sequence = request.sequence;
+                status = authentic(frame, length) ? begin(request) : protocol::OTA_UNAUTHORIZED;
+            }
+        }else if(frame[0] == protocol::OTA_DATA_V2){
+            protocol::ota_data_t chunk;
+            if(protocol::decodeOtaData(frame, length, chunk)){
+                sequence = chunk.sequence;
+                status = write(chunk);
+            }
+        }else if(protocol::decodeOtaEnd(frame, length, sequence)){
+            status = end();
+        }
+
+        report(sequence, status);
+        if(status == protocol::OTA_DONE){
+            LOG_INFO("[OTA] 검증 완료, 재부팅합니다.");
+            release();
+            esp_timer_create_args_t args = {
+                .callback = restart,
+                .name = "ota_restart",
+            };
+            esp_timer_handle_t restartTimer;
+            if(esp_timer_create(&args, &restartTimer) == ESP_OK){
+                esp_timer_start_once(restartTimer, OTA_RESTART_DELAY * 1000ULL);
+            }
+        }else if(status == protocol::OTA_UNAUTHORIZED){
+            LOG_WARN("[OTA] 서명이 맞지 않거나 세션이 없어 거부했습니다.");
+        }else if(status != protocol::OTA_READY && status != protocol::OTA_PROGRESS && status != protocol::OTA_BUSY){
+            LOG_ERROR("[OTA] 실패, status: %d, received: %u, written: %u", status, received, written);
+            abort();
+        }
+        return true;
+    }
+
+    static void verifyTimeout(void* args){
+        LOG_ERROR("[OTA] 새 이미지가 서버에 연결하지 못해 이전 이미지로 되돌립니다.");
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+    }
+
+    // 부팅 시 호출, 검증 대기 중인 새 이미지면 제한 시간 설정
+    // session: 서명 확인에 쓸 현재 세션 토큰(ws::getSession)
+    void begin(bool (*session)(uint8_t* token)){
+        getSession = session;
+        esp_ota_img_states_t state;
+        if(esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) != ESP_OK || state != ESP_OTA_IMG_PENDING_VERIFY){
+            return;
+        }
+        esp_timer_create_args_t args = {
+            .callback = verifyTimeout,
+            .name = "ota_verify",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+        ESP_ERROR_CHECK(esp_timer_start_once(timer, OTA_VERIFY_TIMEOUT * 1000ULL));
+        LOG_INFO("[OTA] 새 이미지, 서버 연결 후 확정됩니다.");
+    }
+
+    // 서버 인증 완료 후 호출
+    void confirm(){
+        if(timer == NULL){
+            return;
+        }
+        esp_timer_stop(timer);
+        esp_timer_delete(timer);
+        timer = NULL;
+        esp_ota_mark_app_valid_cancel_rollback();
+        LOG_INFO("[OTA] 새 이미지를 확정했습니다.");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <atomic>
+#include <string.h>
+#include <esp_websocket_client.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "logger.h"
+#include "ring.h"
+#include "config.h"
+#include "battery.h"
+#include "protocol.h"
+#include "switches.h"
+
+#define OUTBOX_SIZE 16 // 대기 가능한 프레임 수(2의 거듭제곱)
+#define OUTBOX_FRAME_SIZE 192 // STATS_V2 8구간(172바이트)이 들어가는 크기
+#define OUTBOX_CHANNELS SWITCH_CHANNELS
+#define OUTBOX_SEND_TIMEOUT 1000 // 프레임 하나를 보내는 최대 시간(ms)
+
+static_assert(OUTBOX_CHANNELS <= PROTOCOL_MAX_CHANNELS, "프로토콜로 표현할 수 없는 채널 수");
+
+using namespace std;
+
+namespace outbox{
+    typedef struct{
+        uint16_t length;
+        uint8_t data[OUTBOX_FRAME_SIZE];
+    } frame_t;
+
+    static Ring<frame_t, OUTBOX_SIZE> queue;
+    static atomic<bool> pending[OUTBOX_CHANNELS]; // 전송할 상태 변경이 있는 채널, 값은 전송 시점에 switches에서 읽고 전송에 성공해야 지움
+
+    static TaskHandle_t task = NULL;
+    static esp_websocket_client_handle_t client = NULL;
+
+    atomic<uint8_t> version = PROTOCOL_VERSION; // 전송할 프레임 형식
+    atomic<uint16_t> sequence = 0; // v2 프레임 번호
+    atomic<bool> versioned = false; // 서버가 COMMAND_VERSIONED_V2를 보낸 연결이면 SWITCH_VERSION_V2로 전송
+    atomic<bool> ready = false; // 서버 인증을 마친 연결, 그 전에는 상태 변경을 보내지 않고 남겨 둠
+
+    atomic<uint32_t> sentCount = 0;
+    atomic<uint32_t> dropCount = 0;
+    atomic<uint32_t> coalesceCount = 0;
+
+    uint32_t depth(){
+        uint32_t count = queue.size();
+        for(uint8_t i = 0; i < OUTBOX_CHANNELS; ++i){
+            count += pending[i];
+        }
+        return count;
+    }
+
+    // 전송 대기 중인 채널(비트)
+    uint16_t pendingChannels(){
+        uint16_t channels = 0;
+        for(uint8_t i = 0; i < OUTBOX_CHANNELS; ++i){
+            channels |= pending[i] << i;
+        }
+        return channels;
+    }
+
+    static void wake(){
+        if(task != NULL){
+            xTaskNotifyGive(task);
+        }
+    }
+
+    // 서버에 연결되면 호출, 연결이 끊긴 동안 남은 상태 변경을 전송
+    void flush(){
+        wake();
+    }
+
+    // 호출한 태스크를 막지 않음, 큐가 가득 찼으면 버리고 false
+    bool push(const uint8_t* data, uint16_t length){
+        if(length > OUTBOX_FRAME_SIZE || !queue.emplace([&](frame_t& frame){
+            frame.length = length;
+            memcpy(frame.data, data, length);
+        })){
+            ++dropCount;
+            return false;
+        }
+        wake();
+        return true;
+    }
+
+    // 여러 태스크가 바꿔도 전송 시점의 최신 상태를 보내므로 서버에 이전 값이 늦게 도착하지 않음
+    void pushState(uint8_t channel){
+        if(channel >= OUTBOX_CHANNELS){
+            return;
+        }
+        if(pending[channel].exchange(true)){
+            ++coalesceCount;
+        }
+        wake();
+    }
+
+    // 연결이 끊겼거나 전송에 실패하면 false, 이후 전송도 모두 실패로 처리
+    static bool send(bool connected, const uint8_t* data, uint16_t length){
+        if(!connected){
+            ++dropCount;
+            return false;
+        }
+        int sent = esp_websocket_client_send_with_opcode(client, WS_TRANSPORT_OPCODES_BINARY, data, length, pdMS_TO_TICKS(OUTBOX_SEND_TIMEOUT));
+        if(sent < 0){
+            ++dropCount;
+            return false;
+        }
+        ++sentCount;
+        return true;
+    }
+
+    // 전송한 채널의 대기 표시를 지움, 읽은 뒤에 다시 바뀌었으면 남겨 두어 다음에 최신 상태를 전송
+    static void sent(const uint8_t* channels, const uint32_t* versions, uint8_t from, uint8_t to){
+        for(uint8_t i = from; i < to; ++i){
+            pending[channels[i]] = false;
+            if(switches::load(channels[i]).version != versions[i]){
+                pending[channels[i]] = true;
+            }
+        }
+    }
+
+    // 깨어날 때마다 쌓여있는 프레임을 한 번에 모두 전송
+    static void senderTask(void* args){
+        for(;;){
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+            bool connected = esp_websocket_client_is_connected(client);
+            bool hadWork = depth() > 0;
+            // 큐의 프레임은 그 연결에서만 의미가 있으므로(환영, 세션 재개 등) 보내지 못하면 버림
+            for(frame_t* frame = queue.front(); frame != NULL; frame = queue.front()){
+                connected = send(connected, frame->data, frame->length);
+                queue.pop();
+            }
+            if(!connected || !ready){
+                if(hadWork && !connected){
+                    LOG_WARN("[Socket] 전송 실패, queue: %u, drop: %u", depth(), dropCount.load());
+                }
+                continue; // 상태 변경은 남겨 두고 flush()에서 전송
+            }
+            // v2는 대기 중인 모든 채널을 한 프레임으로, v1은 채널마다 한 프레임
+            uint8_t channels[OUTBOX_CHANNELS];
+            uint32_t sentVersions[OUTBOX_CHANNELS];
+            uint8_t entries[OUTBOX_CHANNELS];
+            protocol::versioned_t versions = {
+                .battery = battery::level,
+                .count = 0,
+            };
+            uint8_t count = 0;
+            for(uint8_t channel = 0; channel < OUTBOX_CHANNELS; ++channel){
+                if(!pending[channel]){
+                    continue;
+                }
+                switches::snapshot_t snapshot = switches::load(channel);
+                channels[count] = channel;
+                sentVersions[count] = snapshot.version;
+                entries[count++] = protocol::entry(channel, snapshot.state);
+                versions.entries[versions.count++] = {
+                    .entry = protocol::entry(channel, snapshot.state),
+                    .origin = snapshot.origin,
+                    .version = snapshot.version,
+                };
+            }
+            if(versioned && count > 0){
+                uint8_t buffer[OUTBOX_FRAME_SIZE];
+                protocol::Writer writer(buffer, sizeof(buffer));
+                versions.sequence = sequence++;
+                protocol::encodeSwitchVersion(writer, versions);
+                connected = send(connected, buffer, writer.length);
+                if(connected){
+                    sent(channels, sentVersions, 0, count);
+                }
+                count = 0;
+            }
+            protocol::switch_state_t state = {
+                .version = version,
+                .battery = battery::level,
+            };
+            uint8_t step = state.version >= 2 ? count : 1;
+            for(uint8_t i = 0; i < count; i += step){
+                uint8_t buffer[OUTBOX_FRAME_SIZE];
+                protocol::Writer writer(buffer, sizeof(buffer));
+                state.sequence = state.version >= 2 ? sequence++ : 0;
+                state.count = step;
+                state.entries = &entries[i];
+                protocol::encodeSwitchState(writer, state);
+                connected = send(connected, buffer, writer.length);
+                if(connected){
+                    sent(channels, sentVersions, i, i + step);
+                }
+            }
+            if(hadWork && !connected){
+                LOG_WARN("[Socket] 전송 실패, queue: %u, drop: %u", depth(), dropCount.load());
+            }
+        }
+    }
+
+    void start(esp_websocket_client_handle_t handle){
+        client = handle;
+        for(uint8_t i = 0; i < OUTBOX_CHANNELS; ++i){
+            pending[i] = false;
+        }
+        xTaskCreatePinnedToCore(senderTask, "ws_sender", 4096, NULL, 1, &task, 0);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdio.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_pm.h>
+#include <esp_wifi.h>
+#include <esp_timer.h>
+#endif
+
+#include "logger.h"
+
+#define POWER_MODE_MAINS 0 // 상시 전원: DFS + 자동 라이트 슬립, DTIM마다 수신
+#define POWER_MODE_BATTERY 1 // 배터리: DFS + 자동 라이트 슬립, listen interval 단위로 수신
+#define POWER_MODE_DEEP_SLEEP 2 // 배터리: 평소에는 deep sleep, 터치, 타이머로 깨어나 동작 후 보고하고 다시 잠듦(deepsleep.h)
+
+#ifndef POWER_MODE
+#define POWER_MODE POWER_MODE_MAINS
+#endif
+#define POWER_MIN_FREQ_MHZ 80 // APB 80MHz 유지(LEDC 클럭)
+#define POWER_LISTEN_INTERVAL 3 // 비콘 수신 간격(DTIM 배수), 배터리 모드에서 사용
+#define POWER_REPORT_INTERVAL 60000 // 슬립 비율 출력 주기(ms)
+
+using namespace std;
+
+namespace power{
+    typedef enum{
+        SERVO,
+        TOUCH,
+        OTA,
+        LOCK_MAX,
+    } lock_t;
+
+#ifdef ESP_PLATFORM
+    static esp_pm_lock_handle_t locks[LOCK_MAX] = {NULL};
+    static esp_timer_handle_t timer = NULL;
+
+    static void report(void* args){
+        // 모드별 누적 시간과 비율(SLEEP 항목이 라이트 슬립 비율), 덤프와 순서를 맞추기 위해 직접 출력
+        fputs("[Power] mode stats\n", stdout);
+        esp_pm_dump_locks(stdout);
+    }
+
+    void begin(){
+        esp_pm_config_t config = {
+            .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+            .min_freq_mhz = POWER_MIN_FREQ_MHZ,
+            .light_sleep_enable = true,
+        };
+        esp_err_t err = esp_pm_configure(&config);
+        if(err != ESP_OK){
+            LOG_ERROR("[Power] 전원 관리 설정 실패: %s", esp_err_to_name(err));
+            return;
+        }
+
+        ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "servo", &locks[SERVO]));
+        ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "touch", &locks[TOUCH]));
+        ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "ota", &locks[OTA])); // 압축 해제, 해시 계산
+
+        esp_timer_create_args_t args = {
+            .callback = report,
+            .name = "power",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+        ESP_ERROR_CHECK(esp_timer_start_periodic(timer, POWER_REPORT_INTERVAL * 1000ULL));
+    }
+
+    // WiFi 시작 이후 호출, 비콘 사이에는 모뎀이 꺼짐
+    void wifiSleep(){
+#if POWER_MODE == POWER_MODE_BATTERY
+        wifi_config_t config;
+        if(esp_wifi_get_config(WIFI_IF_STA, &config) == ESP_OK){
+            config.sta.listen_interval = POWER_LISTEN_INTERVAL;
+            esp_wifi_set_config(WIFI_IF_STA, &config);
+        }
+        esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+#else
+        esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+#endif
+    }
+
+    // 잠금은 횟수 기반이므로 acquire, release를 같은 횟수만큼 호출해야 함
+    void acquire(lock_t lock){
+        if(locks[lock] != NULL){
+            esp_pm_lock_acquire(locks[lock]);
+        }
+    }
+
+    void release(lock_t lock){
+        if(locks[lock] != NULL){
+            esp_pm_lock_release(locks[lock]);
+        }
+    }
+#else
+    // 호스트 빌드: 전원 관리 없음
+    void acquire(lock_t lock){
+    }
+
+    void release(lock_t lock){
+    }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <string.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "logger.h"
+#include "utils.h"
+#include "protocol.h"
+
+#define PROFILER_INTERVAL 10000 // 측정 주기(ms)
+#define PROFILER_MAX_TASKS 24 // 태스크가 이보다 많으면 uxTaskGetSystemState가 실패(0개)
+#define PROFILER_TASK_REPORT 6 // 태스크별 시리얼 출력 간격(측정 횟수)
+#define PROFILER_NAME_LENGTH 8 // 전송하는 태스크 이름 최대 길이
+#define PROFILER_TASKS_PER_FRAME 8 // 18 + 14 * 8 = 130바이트, OUTBOX_FRAME_SIZE 이하
+
+using namespace std;
+
+namespace profiler{
+    typedef struct{
+        TaskHandle_t handle;
+        char name[configMAX_TASK_NAME_LEN];
+        uint8_t priority;
+        uint16_t cpu; // ‰, 직전 측정 구간에서 코어 하나 기준
+        uint32_t stackFree; // byte, 스택 high-water mark
+        uint32_t runTime; // 누적 실행 시간, 다음 측정에서 차이 계산
+    } task_sample_t;
+
+    static esp_timer_handle_t timer = NULL;
+    static TaskStatus_t tasks[PROFILER_MAX_TASKS];
+    static task_sample_t fresh[PROFILER_MAX_TASKS]; // 타이머 태스크 스택을 쓰지 않도록 정적 할당
+
+    // 마지막 측정 결과, 타이머 태스크가 쓰고 웹소켓 태스크가 읽음
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    static task_sample_t samples[PROFILER_MAX_TASKS];
+    static uint8_t sampleCount = 0;
+    static uint32_t heapFree = 0;
+    static uint32_t heapLargest = 0;
+    static uint32_t heapMin = 0;
+
+    static uint32_t lastTotal = 0;
+    static uint32_t reportCount = 0;
+
+    // 코어별 IDLE 태스크 누적 실행 시간(us, esp_timer 기준), 빌드끼리 비교할 수 있도록 begin() 이후 합계도 유지
+    static int64_t lastIdleTime = 0;
+    static uint32_t lastIdle[portNUM_PROCESSORS] = {0};
+    static uint64_t idleSum[portNUM_PROCESSORS] = {0};
+    static uint64_t elapsedSum = 0;
+
+    static uint32_t previousRunTime(TaskHandle_t handle){
+        for(uint8_t i = 0; i < sampleCount; ++i){
+            if(samples[i].handle == handle){
+                return samples[i].runTime;
+            }
+        }
+        return 0;
+    }
+
+    // 태스크별 CPU 사용률, 스택 여유, 힙 상태를 측정
+    static void sample(){
+        uint32_t total = 0;
+        UBaseType_t count = uxTaskGetSystemState(tasks, PROFILER_MAX_TASKS, &total);
+
+        // 전체 실행 시간은 모든 코어의 합이 아닌 경과 시간 기준
+        uint32_t elapsed = total - lastTotal;
+        lastTotal = total;
+        for(UBaseType_t i = 0; i < count; ++i){
+            task_sample_t& task = fresh[i];
+            task.handle = tasks[i].xHandle;
+            strncpy(task.name, tasks[i].pcTaskName, sizeof(task.name) - 1);
+            task.name[sizeof(task.name) - 1] = '\0';
+            task.priority = tasks[i].uxCurrentPriority;
+            task.stackFree = tasks[i].usStackHighWaterMark;
+            task.runTime = tasks[i].ulRunTimeCounter;
+            uint32_t ran = task.runTime - previousRunTime(task.handle);
+            task.cpu = elapsed == 0 ? 0 : (uint16_t) MIN(1000, (uint64_t) ran * 1000 / elapsed);
+        }
+
+        uint32_t free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        uint32_t minimum = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+        portENTER_CRITICAL(&lock);
+        memcpy(samples, fresh, sizeof(task_sample_t) * count);
+        sampleCount = count;
+        heapFree = free;
+        heapLargest = largest;
+        heapMin = minimum;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    // IDLE 태스크 실행 시간, uxTaskGetSystemState와 달리 태스크 수(PROFILER_MAX_TASKS)와 관계없이 읽힘
+    static uint32_t idleRunTime(uint8_t core){
+        TaskStatus_t status;
+        vTaskGetInfo(xTaskGetIdleTaskHandleForCPU(core), &status, pdFALSE, eRunning);
+        return status.ulRunTimeCounter;
+    }
+
+    // 코어별 IDLE 태스크가 실행된 비율(0~100), 직전 호출 이후(interval)와 begin() 이후(total)
+    // 카운터는 32비트라 71분마다 넘치므로 구간 차이를 64비트로 누적
+    static void idleRatio(uint8_t* interval, uint8_t* total){
+        int64_t now = esp_timer_get_time();
+        uint64_t elapsed = now - lastIdleTime;
+        lastIdleTime = now;
+        elapsedSum += elapsed;
+        for(uint8_t core = 0; core < portNUM_PROCESSORS; ++core){
+            uint32_t idle = idleRunTime(core);
+            uint32_t ran = idle - lastIdle[core];
+            lastIdle[core] = idle;
+            idleSum[core] += ran;
+            interval[core] = elapsed == 0 ? 0 : (uint8_t) MIN(100, (uint64_t) ran * 100 / elapsed);
+            total[core] = elapsedSum == 0 ? 0 : (uint8_t) MIN(100, idleSum[core] * 100 / elapsedSum);
+        }
+    }
+
+    static void report(void* args){
+        sample();
+
+        uint8_t idle[portNUM_PROCESSORS], total[portNUM_PROCESSORS];
+        idleRatio(idle, total);
+#if portNUM_PROCESSORS > 1
+        LOG_INFO("[CPU] idle core0: %u%% core1: %u%%, total core0: %u%% core1: %u%%", idle[0], idle[1], total[0], total[1]);
+#else
+        LOG_INFO("[CPU] idle core0: %u%%, total core0: %u%%", idle[0], total[0]);
+#endif
+
+        if(++reportCount % PROFILER_TASK_REPORT != 0){
+            return;
+        }
+        for(uint8_t i = 0; i < sampleCount; ++i){
+            const task_sample_t& task = samples[i];
+            LOG_INFO("[Task] %-16s cpu: %3u.%u%%, stack free: %5" PRIu32, logger::Text(task.name), task.cpu / 10, task.cpu % 10, task.stackFree);
+        }
+        LOG_INFO("[Heap] free: %" PRIu32 ", largest: %" PRIu32 ", min: %" PRIu32, heapFree, heapLargest, heapMin);
+    }
+
+    // 마지막 측정 결과 중 part번째 묶음을 기록, part가 범위를 벗어나면 false
+    bool encode(protocol::Writer& writer, uint16_t sequence, uint8_t part){
+        protocol::task_stats_t stats[PROFILER_TASKS_PER_FRAME];
+        protocol::profile_t profile = {
+            .sequence = sequence,
+            .part = part,
+        };
+
+        portENTER_CRITICAL(&lock);
+        profile.parts = MAX(1, (sampleCount + PROFILER_TASKS_PER_FRAME - 1) / PROFILER_TASKS_PER_FRAME);
+        profile.heapFree = heapFree;
+        profile.heapLargest = heapLargest;
+        profile.heapMin = heapMin;
+        uint8_t offset = part * PROFILER_TASKS_PER_FRAME;
+        uint8_t count = offset < sampleCount ? MIN(PROFILER_TASKS_PER_FRAME, sampleCount - offset) : 0;
+        for(uint8_t i = 0; i < count; ++i){
+            const task_sample_t& task = samples[offset + i];
+            stats[i] = {
+                .name = task.name,
+                .nameLength = (uint8_t) strnlen(task.name, PROFILER_NAME_LENGTH),
+                .priority = task.priority,
+                .cpu = task.cpu,
+                .stackFree = (uint16_t) MIN(task.stackFree, (uint32_t) UINT16_MAX),
+            };
+        }
+        bool valid = part < profile.parts;
+        // 이름은 samples를 가리키므로 기록까지 잠금 유지
+        bool written = valid && protocol::encodeProfile(writer, profile, stats, count);
+        portEXIT_CRITICAL(&lock);
+        return written;
+    }
+
+    void begin(){
+        if(timer != NULL){
+            return;
+        }
+        sample();
+        uint8_t idle[portNUM_PROCESSORS], total[portNUM_PROCESSORS];
+        idleRatio(idle, total); // 기준값, 이후 누적에서 부팅 초기화 구간은 빠짐
+        elapsedSum = 0;
+        for(uint8_t core = 0; core < portNUM_PROCESSORS; ++core){
+            idleSum[core] = 0;
+        }
+
+        esp_timer_create_args_t args = {
+            .callback = report,
+            .name = "profiler",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+        ESP_ERROR_CHECK(esp_timer_start_periodic(timer, PROFILER_INTERVAL * 1000ULL));
+    }
+}
\ No newline at end of file
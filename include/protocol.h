@@ -0,0 +1,1074 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ESP-IDF, Arduino에 의존하지 않음(호스트에서 빌드 가능)
+
+#ifndef PROTOCOL_VERSION
+#define PROTOCOL_VERSION 1 // 서버가 v2 프레임을 보내면 v2로 전환됨
+#endif
+
+#define PROTOCOL_DEVICE_TYPE 0x02 // 0x01: checker, 0x02: switch bot
+#define PROTOCOL_MAX_CHANNELS 15
+#define PROTOCOL_TOKEN_SIZE 16 // 세션 재개 토큰
+#define PROTOCOL_OTA_MAC_SIZE 16 // OTA_BEGIN_V2 서명(HMAC-SHA256 앞부분)
+#define PROTOCOL_MAX_SCHEDULES 16
+
+namespace protocol{
+    // v1: 1~3바이트 고정 형식, v2: [type][seq(u16)][payload], type의 최상위 비트가 1
+    typedef enum{
+        WELCOME = 0x01, // [type][device type][switch state, battery][device id]
+        DOOR_STATE = 0x02,
+        SWITCH_STATE = 0x03, // [type][channel << 6 | state << 4 | battery]
+
+        V2 = 0x80,
+        WELCOME_V2 = 0x81, // [type][seq][device type][channel count][state bits(u16)][battery][id length][device id]
+        SWITCH_STATE_V2 = 0x83, // [type][seq][battery][count][channel << 4 | state]...
+        COMMAND_V2 = 0x84, // [type][seq][count][channel << 4 | state]...
+        ACK_V2 = 0x85, // [type][seq][status][time(u64, us)], time은 ack_t 참고
+        STATS_REQUEST_V2 = 0x86, // [type][seq][flags]
+        STATS_V2 = 0x87, // [type][seq][count][stage, count(u32), p50(u32), p90(u32), p99(u32), max(u32)]...
+        OTA_BEGIN_V2 = 0x88, // [type][seq][image size(u32)][compressed size(u32)][image sha256(32)][mac(16)], mac은 앞부분 전체 + 현재 세션 토큰의 HMAC-SHA256(OTA_KEY)
+        OTA_DATA_V2 = 0x89, // [type][seq][offset(u32)][zlib 압축 데이터]
+        OTA_END_V2 = 0x8A, // [type][seq]
+        OTA_STATUS_V2 = 0x8B, // [type][seq][status][received(u32)]
+        SESSION_V2 = 0x8C, // [type][seq][ttl(u16, s)][token(16)], 서버가 환영 메시지 수락 후 발급
+        RESUME_V2 = 0x8D, // [type][seq][token(16)][channel count][state bits(u16)][battery]
+        RESUME_ACK_V2 = 0x8E, // [type][seq][status]
+        TELEMETRY_V2 = 0x8F, // [type][seq][flags][field mask(varint)][value(zigzag varint)]...
+        PROFILE_REQUEST_V2 = 0x90, // [type][seq]
+        PROFILE_V2 = 0x91, // [type][seq][part][parts][heap free(u32)][largest block(u32)][heap min(u32)][count][name length, name, priority, cpu(u16, ‰), stack free(u16)]...
+        CAPTURE_REQUEST_V2 = 0x92, // [type][seq][duration(u16, s)], 0이면 중지
+        CAPTURE_DATA_V2 = 0x93, // [type][seq][offset(u32)][trace.h 형식 데이터], 데이터가 없으면 기록 끝
+        SCHEDULE_SET_V2 = 0x94, // [type][seq][count][id, days, minute(u16), channel, action]..., 전체 교체, ACK_V2로 응답
+        SCHEDULE_GET_V2 = 0x95, // [type][seq]
+        SCHEDULE_V2 = 0x96, // [type][seq][flags][time(u32, s)][count][id, days, minute(u16), channel, action]...
+        COMMAND_VERSIONED_V2 = 0x97, // [type][seq][count][channel << 4 | state, base version(varint)]..., count가 0이면 버전 전송만 요청
+        SWITCH_VERSION_V2 = 0x98, // [type][seq][battery][count][channel << 4 | state, origin, version(varint)]..., COMMAND_VERSIONED_V2를 받은 연결에서 SWITCH_STATE_V2 대신 전송
+    } frame_type_t;
+
+    typedef enum{
+        STATS_RESET = 0x01, // 응답 후 히스토그램 초기화
+    } stats_flag_t;
+
+    typedef enum{
+        ACK_OK,
+        ACK_INVALID,
+        ACK_STALE, // base version이 기기의 현재 버전과 달라(이후 변경, 재부팅 전 버전) 해당 채널은 반영하지 않음
+    } ack_status_t;
+
+    typedef enum{
+        OTA_READY, // OTA_BEGIN_V2 수락
+        OTA_PROGRESS, // OTA_DATA_V2 기록 완료, received까지 수신
+        OTA_DONE, // 검증 완료, 곧 재부팅
+        OTA_BUSY,
+        OTA_INVALID, // 순서, 크기, 압축 데이터 오류
+        OTA_HASH_MISMATCH,
+        OTA_FLASH_ERROR,
+        OTA_UNAUTHORIZED, // 서명이 맞지 않거나 기기에 OTA_KEY 또는 세션 토큰이 없음
+        OTA_DOWNGRADE, // 이미지 버전이 실행 중인 버전보다 높지 않음
+    } ota_status_t;
+
+    typedef enum{
+        RESUME_OK,
+        RESUME_REJECTED, // 만료, 알 수 없는 토큰, 환영 메시지부터 다시 시작
+    } resume_status_t;
+
+    typedef enum{
+        TELEMETRY_KEYFRAME = 0x01, // 값이 직전 프레임과의 차이가 아닌 절대값
+    } telemetry_flag_t;
+
+    // 마스크의 비트 번호, 마스크에 없는 필드는 직전 값과 같음
+    typedef enum{
+        TELEMETRY_RSSI, // dBm
+        TELEMETRY_HEAP_FREE, // byte
+        TELEMETRY_HEAP_MIN, // byte, 부팅 후 최소값
+        TELEMETRY_UPTIME, // s
+        TELEMETRY_WIFI_CONNECTS, // 부팅 후 WiFi 연결 횟수
+        TELEMETRY_SOCKET_CONNECTS, // 부팅 후 웹소켓 연결 횟수
+        TELEMETRY_BATTERY_MV,
+        TELEMETRY_TOUCH_BASELINE, // 채널 0, 이후 채널마다 1씩 증가
+        TELEMETRY_FIELD_MAX = TELEMETRY_TOUCH_BASELINE + 4,
+    } telemetry_field_t;
+
+    typedef enum{
+        SCHEDULE_OFF,
+        SCHEDULE_ON,
+        SCHEDULE_TOGGLE,
+    } schedule_action_t;
+
+    typedef enum{
+        SCHEDULE_TIME_SYNCED = 0x01, // 부팅 후 SNTP 동기화 완료
+    } schedule_flag_t;
+
+    // 스위치 상태를 마지막으로 바꾼 주체
+    typedef enum{
+        ORIGIN_RESTORE, // 부팅 시 저장된 상태
+        ORIGIN_TOUCH,
+        ORIGIN_SERVER,
+        ORIGIN_LAN,
+        ORIGIN_SCHEDULE,
+    } origin_t;
+
+    // 부호 있는 차이를 작은 양수로 변환(0, -1, 1, -2 -> 0, 1, 2, 3)
+    inline uint32_t zigzag(int32_t value){
+        return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+    }
+
+    inline int32_t unzigzag(uint32_t value){
+        return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+    }
+
+    inline uint8_t entry(uint8_t channel, bool state){
+        return (channel << 4) | (state ? 1 : 0);
+    }
+
+    inline uint8_t entryChannel(uint8_t entry){
+        return entry >> 4;
+    }
+
+    inline bool entryState(uint8_t entry){
+        return entry & 0x01;
+    }
+
+    // 호출자가 준 버퍼에 직접 기록, 공간이 부족하면 overflow
+    struct Writer{
+        uint8_t* buffer;
+        uint16_t capacity;
+        uint16_t length;
+        bool overflow;
+
+        Writer(uint8_t* buffer, uint16_t capacity): buffer(buffer), capacity(capacity), length(0), overflow(false){}
+
+        uint8_t* reserve(uint16_t size){
+            if(overflow || capacity - length < size){
+                overflow = true;
+                return NULL;
+            }
+            uint8_t* position = buffer + length;
+            length += size;
+            return position;
+        }
+
+        void u8(uint8_t value){
+            uint8_t* position = reserve(1);
+            if(position != NULL){
+                *position = value;
+            }
+        }
+
+        void u16(uint16_t value){
+            uint8_t* position = reserve(2);
+            if(position != NULL){
+                position[0] = value;
+                position[1] = value >> 8;
+            }
+        }
+
+        void u32(uint32_t value){
+            uint8_t* position = reserve(4);
+            if(position != NULL){
+                for(uint8_t i = 0; i < 4; ++i){
+                    position[i] = value >> (i * 8);
+                }
+            }
+        }
+
+        void u64(uint64_t value){
+            uint8_t* position = reserve(8);
+            if(position != NULL){
+                for(uint8_t i = 0; i < 8; ++i){
+                    position[i] = value >> (i * 8);
+                }
+            }
+        }
+
+        // 7비트씩 하위부터, 127 이하는 1바이트
+        void varint(uint32_t value){
+            while(value >= 0x80){
+                u8(value | 0x80);
+                value >>= 7;
+            }
+            u8(value);
+        }
+
+        void bytes(const void* data, uint16_t size){
+            uint8_t* position = reserve(size);
+            if(position != NULL){
+                memcpy(position, data, size);
+            }
+        }
+
+        bool ok() const{
+            return !overflow;
+        }
+    };
+
+    // 수신 버퍼를 복사하지 않고 읽음, 범위를 벗어나면 error
+    struct Reader{
+        const uint8_t* data;
+        uint16_t length;
+        uint16_t offset;
+        bool error;
+
+        Reader(const uint8_t* data, uint16_t length): data(data), length(length), offset(0), error(false){}
+
+        const uint8_t* take(uint16_t size){
+            if(error || length - offset < size){
+                error = true;
+                return NULL;
+            }
+            const uint8_t* position = data + offset;
+            offset += size;
+            return position;
+        }
+
+        uint8_t u8(){
+            const uint8_t* position = take(1);
+            return position == NULL ? 0 : position[0];
+        }
+
+        uint16_t u16(){
+            const uint8_t* position = take(2);
+            return position == NULL ? 0 : position[0] | (position[1] << 8);
+        }
+
+        uint32_t u32(){
+            const uint8_t* position = take(4);
+            uint32_t value = 0;
+            for(uint8_t i = 0; position != NULL && i < 4; ++i){
+                value |= (uint32_t) position[i] << (i * 8);
+            }
+            return value;
+        }
+
+        uint64_t u64(){
+            const uint8_t* position = take(8);
+            uint64_t value = 0;
+            for(uint8_t i = 0; position != NULL && i < 8; ++i){
+                value |= (uint64_t) position[i] << (i * 8);
+            }
+            return value;
+        }
+
+        uint32_t varint(){
+            uint32_t value = 0;
+            for(uint8_t shift = 0; shift < 35; shift += 7){
+                const uint8_t* position = take(1);
+                if(position == NULL){
+                    return 0;
+                }
+                value |= (uint32_t) (*position & 0x7F) << shift;
+                if(!(*position & 0x80)){
+                    return value;
+                }
+            }
+            error = true;
+            return 0;
+        }
+
+        bool done() const{
+            return !error && offset == length;
+        }
+    };
+
+    typedef struct{
+        uint8_t version;
+        uint16_t sequence; // v1은 항상 0
+        uint8_t channelCount;
+        uint16_t states; // 채널별 상태 비트
+        uint8_t battery;
+        const char* deviceId; // 수신 버퍼를 가리킴
+        uint8_t deviceIdLength;
+    } welcome_t;
+
+    typedef struct{
+        uint8_t version;
+        uint16_t sequence;
+        uint8_t battery;
+        uint8_t count;
+        const uint8_t* entries; // entry(channel, state) 배열, 수신 버퍼를 가리킴(NULL이면 single 사용)
+        uint8_t single;
+    } switch_state_t;
+
+    typedef switch_state_t command_t; // battery는 사용하지 않음
+
+    inline uint8_t entryAt(const switch_state_t& state, uint8_t index){
+        return state.entries == NULL ? state.single : state.entries[index];
+    }
+
+    typedef struct{
+        uint16_t sequence;
+        uint8_t status;
+        uint64_t time; // us, 웹소켓: 서보 이동 명령(servo::move) 직후, LAN RESPONSE: 명령 수락(스위치 상태 반영) 시각
+    } ack_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint8_t flags;
+    } stats_request_t;
+
+    typedef struct{
+        uint8_t stage;
+        uint32_t count;
+        uint32_t p50;
+        uint32_t p90;
+        uint32_t p99;
+        uint32_t max;
+    } stage_stats_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint32_t imageSize;
+        uint32_t compressedSize;
+        uint8_t sha256[32];
+        uint8_t mac[PROTOCOL_OTA_MAC_SIZE];
+    } ota_begin_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint32_t offset; // 압축 데이터 기준 위치
+        const uint8_t* data; // 수신 버퍼를 가리킴
+        uint16_t length;
+    } ota_data_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint8_t status;
+        uint32_t received; // 처리한 압축 데이터 크기
+    } ota_report_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint16_t ttl; // s
+        uint8_t token[PROTOCOL_TOKEN_SIZE];
+    } session_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint8_t token[PROTOCOL_TOKEN_SIZE];
+        uint8_t channelCount;
+        uint16_t states;
+        uint8_t battery;
+    } resume_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint8_t status;
+    } resume_ack_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint8_t flags;
+        uint32_t mask; // 1 << telemetry_field_t
+        int32_t values[TELEMETRY_FIELD_MAX]; // 마스크에 있는 필드만 사용
+    } telemetry_t;
+
+    // 태스크가 많으면 여러 프레임(part)으로 나눠 같은 seq로 전송
+    typedef struct{
+        uint16_t sequence;
+        uint8_t part;
+        uint8_t parts;
+        uint32_t heapFree; // byte
+        uint32_t heapLargest; // 할당 가능한 가장 큰 블록
+        uint32_t heapMin; // 부팅 후 최소값
+    } profile_t;
+
+    typedef struct{
+        const char* name; // 수신 버퍼를 가리킴, NULL 종료 아님
+        uint8_t nameLength;
+        uint8_t priority;
+        uint16_t cpu; // ‰, 직전 측정 구간에서 코어 하나 기준
+        uint16_t stackFree; // byte, 실행 후 가장 적었던 남은 스택
+    } task_stats_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint32_t offset; // 기록 시작부터의 위치
+        const uint8_t* data; // 수신 버퍼를 가리킴
+        uint16_t length;
+    } capture_data_t;
+
+    // 기기 현지 시각 기준, NVS에 그대로 저장됨
+    typedef struct{
+        uint8_t id; // 서버가 정한 번호
+        uint8_t days; // bit 0: 일요일 ~ bit 6: 토요일, 0이면 다음 해당 시각에 한 번만 실행 후 삭제
+        uint16_t minute; // 하루 중 분(0~1439)
+        uint8_t channel;
+        uint8_t action; // schedule_action_t
+    } schedule_entry_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint8_t flags; // SCHEDULE_V2만 사용
+        uint32_t time; // s, 기기의 현재 시각(UNIX), SCHEDULE_V2만 사용
+        uint8_t count;
+        schedule_entry_t entries[PROTOCOL_MAX_SCHEDULES];
+    } schedule_t;
+
+    typedef struct{
+        uint8_t entry; // entry(channel, state)
+        uint8_t origin; // origin_t, SWITCH_VERSION_V2만 사용
+        uint32_t version; // 명령: 서버가 마지막으로 본 버전, 상태: 현재 버전
+    } versioned_entry_t;
+
+    typedef struct{
+        uint16_t sequence;
+        uint8_t battery; // SWITCH_VERSION_V2만 사용
+        uint8_t count;
+        versioned_entry_t entries[PROTOCOL_MAX_CHANNELS];
+    } versioned_t;
+
+    // v1은 채널 2개까지만 표현 가능(상단: bit 6, 하단: bit 4)
+    inline bool encodeWelcome(Writer& writer, const welcome_t& welcome){
+        if(welcome.version < 2){
+            writer.u8(WELCOME);
+            writer.u8(PROTOCOL_DEVICE_TYPE);
+            writer.u8(((welcome.states & 0b01) << 6) | ((welcome.states & 0b10) << 3) | (welcome.battery & 0b1111));
+            writer.bytes(welcome.deviceId, welcome.deviceIdLength);
+        }else{
+            writer.u8(WELCOME_V2);
+            writer.u16(welcome.sequence);
+            writer.u8(PROTOCOL_DEVICE_TYPE);
+            writer.u8(welcome.channelCount);
+            writer.u16(welcome.states);
+            writer.u8(welcome.battery);
+            writer.u8(welcome.deviceIdLength);
+            writer.bytes(welcome.deviceId, welcome.deviceIdLength);
+        }
+        return writer.ok();
+    }
+
+    // v1은 프레임 하나에 채널 하나, count가 1이 아니면 실패
+    inline bool encodeSwitchState(Writer& writer, const switch_state_t& state){
+        if(state.version < 2){
+            if(state.count != 1){
+                return false;
+            }
+            uint8_t first = entryAt(state, 0);
+            writer.u8(SWITCH_STATE);
+            writer.u8((entryChannel(first) << 6) | (entryState(first) << 4) | (state.battery & 0b1111));
+        }else{
+            writer.u8(SWITCH_STATE_V2);
+            writer.u16(state.sequence);
+            writer.u8(state.battery);
+            writer.u8(state.count);
+            for(uint8_t i = 0; i < state.count; ++i){
+                writer.u8(entryAt(state, i));
+            }
+        }
+        return writer.ok();
+    }
+
+    inline bool encodeCommand(Writer& writer, const command_t& command){
+        if(command.version < 2){
+            if(command.count != 1){
+                return false;
+            }
+            writer.u8(entryAt(command, 0));
+        }else{
+            writer.u8(COMMAND_V2);
+            writer.u16(command.sequence);
+            writer.u8(command.count);
+            for(uint8_t i = 0; i < command.count; ++i){
+                writer.u8(entryAt(command, i));
+            }
+        }
+        return writer.ok();
+    }
+
+    inline bool encodeAck(Writer& writer, const ack_t& ack){
+        writer.u8(ACK_V2);
+        writer.u16(ack.sequence);
+        writer.u8(ack.status);
+        writer.u64(ack.time);
+        return writer.ok();
+    }
+
+    inline bool encodeStatsRequest(Writer& writer, const stats_request_t& request){
+        writer.u8(STATS_REQUEST_V2);
+        writer.u16(request.sequence);
+        writer.u8(request.flags);
+        return writer.ok();
+    }
+
+    inline bool encodeStats(Writer& writer, uint16_t sequence, const stage_stats_t* stages, uint8_t count){
+        writer.u8(STATS_V2);
+        writer.u16(sequence);
+        writer.u8(count);
+        for(uint8_t i = 0; i < count; ++i){
+            writer.u8(stages[i].stage);
+            writer.u32(stages[i].count);
+            writer.u32(stages[i].p50);
+            writer.u32(stages[i].p90);
+            writer.u32(stages[i].p99);
+            writer.u32(stages[i].max);
+        }
+        return writer.ok();
+    }
+
+    inline bool decodeWelcome(const uint8_t* data, uint16_t length, welcome_t& welcome){
+        Reader reader(data, length);
+        uint8_t type = reader.u8();
+        if(type == WELCOME){
+            welcome.version = 1;
+            welcome.sequence = 0;
+            if(reader.u8() != PROTOCOL_DEVICE_TYPE){
+                return false;
+            }
+            uint8_t packed = reader.u8();
+            welcome.channelCount = 2;
+            welcome.states = ((packed >> 6) & 0b01) | ((packed >> 3) & 0b10);
+            welcome.battery = packed & 0b1111;
+            welcome.deviceIdLength = length - reader.offset;
+            welcome.deviceId = (const char*) reader.take(welcome.deviceIdLength);
+        }else if(type == WELCOME_V2){
+            welcome.version = 2;
+            welcome.sequence = reader.u16();
+            if(reader.u8() != PROTOCOL_DEVICE_TYPE){
+                return false;
+            }
+            welcome.channelCount = reader.u8();
+            welcome.states = reader.u16();
+            welcome.battery = reader.u8();
+            welcome.deviceIdLength = reader.u8();
+            welcome.deviceId = (const char*) reader.take(welcome.deviceIdLength);
+        }else{
+            return false;
+        }
+        return reader.done() && welcome.channelCount <= PROTOCOL_MAX_CHANNELS;
+    }
+
+    inline bool decodeSwitchState(const uint8_t* data, uint16_t length, switch_state_t& state){
+        Reader reader(data, length);
+        uint8_t type = reader.u8();
+        if(type == SWITCH_STATE){
+            uint8_t packed = reader.u8();
+            if(reader.error){
+                return false;
+            }
+            // v1은 채널과 배터리가 한 바이트에 있으므로 entry로 변환해 저장
+            state.version = 1;
+            state.sequence = 0;
+            state.battery = packed & 0b1111;
+            state.count = 1;
+            state.entries = NULL;
+            state.single = entry(packed >> 6, (packed >> 4) & 0x01);
+        }else if(type == SWITCH_STATE_V2){
+            state.version = 2;
+            state.sequence = reader.u16();
+            state.battery = reader.u8();
+            state.count = reader.u8();
+            state.entries = reader.take(state.count);
+            if(state.entries == NULL){
+                return false;
+            }
+        }else{
+            return false;
+        }
+        return reader.done();
+    }
+
+    // 서버 -> 기기 명령, v1: 1바이트, v2: COMMAND_V2
+    inline bool decodeCommand(const uint8_t* data, uint16_t length, command_t& command){
+        if(length == 1){
+            command.version = 1;
+            command.sequence = 0;
+            command.battery = 0;
+            command.count = 1;
+            command.entries = data;
+            return data != NULL;
+        }
+
+        Reader reader(data, length);
+        if(reader.u8() != COMMAND_V2){
+            return false;
+        }
+        command.version = 2;
+        command.sequence = reader.u16();
+        command.battery = 0;
+        command.count = reader.u8();
+        command.entries = reader.take(command.count);
+        return reader.done() && command.count > 0 && command.entries != NULL;
+    }
+
+    inline bool decodeAck(const uint8_t* data, uint16_t length, ack_t& ack){
+        Reader reader(data, length);
+        if(reader.u8() != ACK_V2){
+            return false;
+        }
+        ack.sequence = reader.u16();
+        ack.status = reader.u8();
+        ack.time = reader.u64();
+        return reader.done();
+    }
+
+    inline bool decodeStatsRequest(const uint8_t* data, uint16_t length, stats_request_t& request){
+        Reader reader(data, length);
+        if(reader.u8() != STATS_REQUEST_V2){
+            return false;
+        }
+        request.sequence = reader.u16();
+        request.flags = reader.u8();
+        return reader.done();
+    }
+
+    // stages는 최소 capacity개, 실제 개수는 count
+    inline bool decodeStats(const uint8_t* data, uint16_t length, uint16_t& sequence, stage_stats_t* stages, uint8_t capacity, uint8_t& count){
+        Reader reader(data, length);
+        if(reader.u8() != STATS_V2){
+            return false;
+        }
+        sequence = reader.u16();
+        count = reader.u8();
+        if(count > capacity){
+            return false;
+        }
+        for(uint8_t i = 0; i < count; ++i){
+            stages[i].stage = reader.u8();
+            stages[i].count = reader.u32();
+            stages[i].p50 = reader.u32();
+            stages[i].p90 = reader.u32();
+            stages[i].p99 = reader.u32();
+            stages[i].max = reader.u32();
+        }
+        return reader.done();
+    }
+
+    inline bool encodeOtaBegin(Writer& writer, const ota_begin_t& begin){
+        writer.u8(OTA_BEGIN_V2);
+        writer.u16(begin.sequence);
+        writer.u32(begin.imageSize);
+        writer.u32(begin.compressedSize);
+        writer.bytes(begin.sha256, sizeof(begin.sha256));
+        writer.bytes(begin.mac, sizeof(begin.mac));
+        return writer.ok();
+    }
+
+    inline bool encodeOtaData(Writer& writer, const ota_data_t& data){
+        writer.u8(OTA_DATA_V2);
+        writer.u16(data.sequence);
+        writer.u32(data.offset);
+        writer.bytes(data.data, data.length);
+        return writer.ok();
+    }
+
+    inline bool encodeOtaEnd(Writer& writer, uint16_t sequence){
+        writer.u8(OTA_END_V2);
+        writer.u16(sequence);
+        return writer.ok();
+    }
+
+    inline bool encodeOtaStatus(Writer& writer, const ota_report_t& report){
+        writer.u8(OTA_STATUS_V2);
+        writer.u16(report.sequence);
+        writer.u8(report.status);
+        writer.u32(report.received);
+        return writer.ok();
+    }
+
+    inline bool decodeOtaBegin(const uint8_t* data, uint16_t length, ota_begin_t& begin){
+        Reader reader(data, length);
+        if(reader.u8() != OTA_BEGIN_V2){
+            return false;
+        }
+        begin.sequence = reader.u16();
+        begin.imageSize = reader.u32();
+        begin.compressedSize = reader.u32();
+        const uint8_t* hash = reader.take(sizeof(begin.sha256));
+        if(hash == NULL){
+            return false;
+        }
+        memcpy(begin.sha256, hash, sizeof(begin.sha256));
+        const uint8_t* mac = reader.take(sizeof(begin.mac));
+        if(mac == NULL){
+            return false;
+        }
+        memcpy(begin.mac, mac, sizeof(begin.mac));
+        return reader.done();
+    }
+
+    inline bool decodeOtaData(const uint8_t* data, uint16_t length, ota_data_t& chunk){
+        Reader reader(data, length);
+        if(reader.u8() != OTA_DATA_V2){
+            return false;
+        }
+        chunk.sequence = reader.u16();
+        chunk.offset = reader.u32();
+        chunk.length = length - reader.offset;
+        chunk.data = reader.take(chunk.length);
+        return reader.done() && chunk.length > 0;
+    }
+
+    inline bool decodeOtaEnd(const uint8_t* data, uint16_t length, uint16_t& sequence){
+        Reader reader(data, length);
+        if(reader.u8() != OTA_END_V2){
+            return false;
+        }
+        sequence = reader.u16();
+        return reader.done();
+    }
+
+    inline bool decodeOtaStatus(const uint8_t* data, uint16_t length, ota_report_t& report){
+        Reader reader(data, length);
+        if(reader.u8() != OTA_STATUS_V2){
+            return false;
+        }
+        report.sequence = reader.u16();
+        report.status = reader.u8();
+        report.received = reader.u32();
+        return reader.done();
+    }
+
+    inline bool encodeSession(Writer& writer, const session_t& session){
+        writer.u8(SESSION_V2);
+        writer.u16(session.sequence);
+        writer.u16(session.ttl);
+        writer.bytes(session.token, sizeof(session.token));
+        return writer.ok();
+    }
+
+    inline bool encodeResume(Writer& writer, const resume_t& resume){
+        writer.u8(RESUME_V2);
+        writer.u16(resume.sequence);
+        writer.bytes(resume.token, sizeof(resume.token));
+        writer.u8(resume.channelCount);
+        writer.u16(resume.states);
+        writer.u8(resume.battery);
+        return writer.ok();
+    }
+
+    inline bool encodeResumeAck(Writer& writer, const resume_ack_t& ack){
+        writer.u8(RESUME_ACK_V2);
+        writer.u16(ack.sequence);
+        writer.u8(ack.status);
+        return writer.ok();
+    }
+
+    inline bool decodeSession(const uint8_t* data, uint16_t length, session_t& session){
+        Reader reader(data, length);
+        if(reader.u8() != SESSION_V2){
+            return false;
+        }
+        session.sequence = reader.u16();
+        session.ttl = reader.u16();
+        const uint8_t* token = reader.take(sizeof(session.token));
+        if(token == NULL){
+            return false;
+        }
+        memcpy(session.token, token, sizeof(session.token));
+        return reader.done();
+    }
+
+    inline bool decodeResume(const uint8_t* data, uint16_t length, resume_t& resume){
+        Reader reader(data, length);
+        if(reader.u8() != RESUME_V2){
+            return false;
+        }
+        resume.sequence = reader.u16();
+        const uint8_t* token = reader.take(sizeof(resume.token));
+        if(token == NULL){
+            return false;
+        }
+        memcpy(resume.token, token, sizeof(resume.token));
+        resume.channelCount = reader.u8();
+        resume.states = reader.u16();
+        resume.battery = reader.u8();
+        return reader.done();
+    }
+
+    inline bool decodeResumeAck(const uint8_t* data, uint16_t length, resume_ack_t& ack){
+        Reader reader(data, length);
+        if(reader.u8() != RESUME_ACK_V2){
+            return false;
+        }
+        ack.sequence = reader.u16();
+        ack.status = reader.u8();
+        return reader.done();
+    }
+
+    inline bool encodeTelemetry(Writer& writer, const telemetry_t& telemetry){
+        writer.u8(TELEMETRY_V2);
+        writer.u16(telemetry.sequence);
+        writer.u8(telemetry.flags);
+        writer.varint(telemetry.mask);
+        for(uint8_t i = 0; i < TELEMETRY_FIELD_MAX; ++i){
+            if(telemetry.mask & (1 << i)){
+                writer.varint(zigzag(telemetry.values[i]));
+            }
+        }
+        return writer.ok();
+    }
+
+    inline bool decodeTelemetry(const uint8_t* data, uint16_t length, telemetry_t& telemetry){
+        Reader reader(data, length);
+        if(reader.u8() != TELEMETRY_V2){
+            return false;
+        }
+        telemetry.sequence = reader.u16();
+        telemetry.flags = reader.u8();
+        telemetry.mask = reader.varint();
+        if(telemetry.mask >> TELEMETRY_FIELD_MAX){
+            return false;
+        }
+        for(uint8_t i = 0; i < TELEMETRY_FIELD_MAX; ++i){
+            telemetry.values[i] = telemetry.mask & (1 << i) ? unzigzag(reader.varint()) : 0;
+        }
+        return reader.done();
+    }
+
+    inline bool encodeProfileRequest(Writer& writer, uint16_t sequence){
+        writer.u8(PROFILE_REQUEST_V2);
+        writer.u16(sequence);
+        return writer.ok();
+    }
+
+    inline bool encodeProfile(Writer& writer, const profile_t& profile, const task_stats_t* tasks, uint8_t count){
+        writer.u8(PROFILE_V2);
+        writer.u16(profile.sequence);
+        writer.u8(profile.part);
+        writer.u8(profile.parts);
+        writer.u32(profile.heapFree);
+        writer.u32(profile.heapLargest);
+        writer.u32(profile.heapMin);
+        writer.u8(count);
+        for(uint8_t i = 0; i < count; ++i){
+            writer.u8(tasks[i].nameLength);
+            writer.bytes(tasks[i].name, tasks[i].nameLength);
+            writer.u8(tasks[i].priority);
+            writer.u16(tasks[i].cpu);
+            writer.u16(tasks[i].stackFree);
+        }
+        return writer.ok();
+    }
+
+    inline bool decodeProfileRequest(const uint8_t* data, uint16_t length, uint16_t& sequence){
+        Reader reader(data, length);
+        if(reader.u8() != PROFILE_REQUEST_V2){
+            return false;
+        }
+        sequence = reader.u16();
+        return reader.done();
+    }
+
+    // tasks는 최소 capacity개, 실제 개수는 count
+    inline bool decodeProfile(const uint8_t* data, uint16_t length, profile_t& profile, task_stats_t* tasks, uint8_t capacity, uint8_t& count){
+        Reader reader(data, length);
+        if(reader.u8() != PROFILE_V2){
+            return false;
+        }
+        profile.sequence = reader.u16();
+        profile.part = reader.u8();
+        profile.parts = reader.u8();
+        profile.heapFree = reader.u32();
+        profile.heapLargest = reader.u32();
+        profile.heapMin = reader.u32();
+        count = reader.u8();
+        if(count > capacity){
+            return false;
+        }
+        for(uint8_t i = 0; i < count; ++i){
+            tasks[i].nameLength = reader.u8();
+            tasks[i].name = (const char*) reader.take(tasks[i].nameLength);
+            tasks[i].priority = reader.u8();
+            tasks[i].cpu = reader.u16();
+            tasks[i].stackFree = reader.u16();
+        }
+        return reader.done();
+    }
+
+    inline bool encodeCaptureRequest(Writer& writer, uint16_t sequence, uint16_t duration){
+        writer.u8(CAPTURE_REQUEST_V2);
+        writer.u16(sequence);
+        writer.u16(duration);
+        return writer.ok();
+    }
+
+    inline bool encodeCaptureData(Writer& writer, const capture_data_t& data){
+        writer.u8(CAPTURE_DATA_V2);
+        writer.u16(data.sequence);
+        writer.u32(data.offset);
+        writer.bytes(data.data, data.length);
+        return writer.ok();
+    }
+
+    inline bool decodeCaptureRequest(const uint8_t* data, uint16_t length, uint16_t& sequence, uint16_t& duration){
+        Reader reader(data, length);
+        if(reader.u8() != CAPTURE_REQUEST_V2){
+            return false;
+        }
+        sequence = reader.u16();
+        duration = reader.u16();
+        return reader.done();
+    }
+
+    inline bool decodeCaptureData(const uint8_t* data, uint16_t length, capture_data_t& chunk){
+        Reader reader(data, length);
+        if(reader.u8() != CAPTURE_DATA_V2){
+            return false;
+        }
+        chunk.sequence = reader.u16();
+        chunk.offset = reader.u32();
+        chunk.length = length - reader.offset;
+        chunk.data = reader.take(chunk.length);
+        return reader.done();
+    }
+
+    inline void writeScheduleEntries(Writer& writer, const schedule_t& schedule){
+        writer.u8(schedule.count);
+        for(uint8_t i = 0; i < schedule.count; ++i){
+            const schedule_entry_t& entry = schedule.entries[i];
+            writer.u8(entry.id);
+            writer.u8(entry.days);
+            writer.u16(entry.minute);
+            writer.u8(entry.channel);
+            writer.u8(entry.action);
+        }
+    }
+
+    inline bool readScheduleEntries(Reader& reader, schedule_t& schedule){
+        schedule.count = reader.u8();
+        if(schedule.count > PROTOCOL_MAX_SCHEDULES){
+            return false;
+        }
+        for(uint8_t i = 0; i < schedule.count; ++i){
+            schedule_entry_t& entry = schedule.entries[i];
+            entry.id = reader.u8();
+            entry.days = reader.u8();
+            entry.minute = reader.u16();
+            entry.channel = reader.u8();
+            entry.action = reader.u8();
+        }
+        return reader.done();
+    }
+
+    inline bool encodeScheduleSet(Writer& writer, const schedule_t& schedule){
+        if(schedule.count > PROTOCOL_MAX_SCHEDULES){
+            return false;
+        }
+        writer.u8(SCHEDULE_SET_V2);
+        writer.u16(schedule.sequence);
+        writeScheduleEntries(writer, schedule);
+        return writer.ok();
+    }
+
+    inline bool encodeScheduleGet(Writer& writer, uint16_t sequence){
+        writer.u8(SCHEDULE_GET_V2);
+        writer.u16(sequence);
+        return writer.ok();
+    }
+
+    inline bool encodeSchedule(Writer& writer, const schedule_t& schedule){
+        if(schedule.count > PROTOCOL_MAX_SCHEDULES){
+            return false;
+        }
+        writer.u8(SCHEDULE_V2);
+        writer.u16(schedule.sequence);
+        writer.u8(schedule.flags);
+        writer.u32(schedule.time);
+        writeScheduleEntries(writer, schedule);
+        return writer.ok();
+    }
+
+    // 값의 범위는 확인하지 않음(채널 수는 기기마다 다름)
+    inline bool decodeScheduleSet(const uint8_t* data, uint16_t length, schedule_t& schedule){
+        Reader reader(data, length);
+        if(reader.u8() != SCHEDULE_SET_V2){
+            return false;
+        }
+        schedule.sequence = reader.u16();
+        schedule.flags = 0;
+        schedule.time = 0;
+        return readScheduleEntries(reader, schedule);
+    }
+
+    inline bool decodeScheduleGet(const uint8_t* data, uint16_t length, uint16_t& sequence){
+        Reader reader(data, length);
+        if(reader.u8() != SCHEDULE_GET_V2){
+            return false;
+        }
+        sequence = reader.u16();
+        return reader.done();
+    }
+
+    inline bool decodeSchedule(const uint8_t* data, uint16_t length, schedule_t& schedule){
+        Reader reader(data, length);
+        if(reader.u8() != SCHEDULE_V2){
+            return false;
+        }
+        schedule.sequence = reader.u16();
+        schedule.flags = reader.u8();
+        schedule.time = reader.u32();
+        return readScheduleEntries(reader, schedule);
+    }
+
+    inline bool encodeVersionedCommand(Writer& writer, const versioned_t& command){
+        if(command.count > PROTOCOL_MAX_CHANNELS){
+            return false;
+        }
+        writer.u8(COMMAND_VERSIONED_V2);
+        writer.u16(command.sequence);
+        writer.u8(command.count);
+        for(uint8_t i = 0; i < command.count; ++i){
+            writer.u8(command.entries[i].entry);
+            writer.varint(command.entries[i].version);
+        }
+        return writer.ok();
+    }
+
+    inline bool encodeSwitchVersion(Writer& writer, const versioned_t& state){
+        if(state.count > PROTOCOL_MAX_CHANNELS){
+            return false;
+        }
+        writer.u8(SWITCH_VERSION_V2);
+        writer.u16(state.sequence);
+        writer.u8(state.battery);
+        writer.u8(state.count);
+        for(uint8_t i = 0; i < state.count; ++i){
+            writer.u8(state.entries[i].entry);
+            writer.u8(state.entries[i].origin);
+            writer.varint(state.entries[i].version);
+        }
+        return writer.ok();
+    }
+
+    inline bool decodeVersionedCommand(const uint8_t* data, uint16_t length, versioned_t& command){
+        Reader reader(data, length);
+        if(reader.u8() != COMMAND_VERSIONED_V2){
+            return false;
+        }
+        command.sequence = reader.u16();
+        command.battery = 0;
+        command.count = reader.u8();
+        if(command.count > PROTOCOL_MAX_CHANNELS){
+            return false;
+        }
+        for(uint8_t i = 0; i < command.count; ++i){
+            command.entries[i].entry = reader.u8();
+            command.entries[i].origin = ORIGIN_SERVER;
+            command.entries[i].version = reader.varint();
+        }
+        return reader.done();
+    }
+
+    inline bool decodeSwitchVersion(const uint8_t* data, uint16_t length, versioned_t& state){
+        Reader reader(data, length);
+        if(reader.u8() != SWITCH_VERSION_V2){
+            return false;
+        }
+        state.sequence = reader.u16();
+        state.battery = reader.u8();
+        state.count = reader.u8();
+        if(state.count > PROTOCOL_MAX_CHANNELS){
+            return false;
+        }
+        for(uint8_t i = 0; i < state.count; ++i){
+            state.entries[i].entry = reader.u8();
+            state.entries[i].origin = reader.u8();
+            state.entries[i].version = reader.varint();
+        }
+        return reader.done();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#else
+#include <mutex>
+#include <deque>
+#endif
+
+#define REACTOR_QUEUE_SIZE 16
+
+namespace reactor{
+    typedef enum{
+        SWITCH_CHANGED, // arg: 채널
+        WIFI_CONNECTED,
+        WIFI_DISCONNECTED,
+        SOCKET_CONNECTED,
+        SOCKET_DISCONNECTED,
+        SERVER_CONNECTED,
+        RESUME_REJECTED, // 세션 재개 실패, 바로 환영 메시지 전송
+        COMMAND_APPLIED, // arg: 대상 채널 비트 << 24 | 상태 << 16 | 명령 번호
+        STORAGE_FLUSH, // 설정 저장 예약 시간 도달
+        TELEMETRY_DUE, // 상태 정보 전송 주기 도달
+        TIME_SYNCED, // SNTP 동기화 완료
+        SCHEDULE_DUE, // 일정 실행 시각 도달 또는 일정 변경
+        SLEEP_DUE, // deep sleep 모드에서 잠들 시간 도달
+        SERVO_SETTLED, // arg: 채널, 서보가 목표 위치에 도착
+    } event_type_t;
+
+    typedef struct{
+        event_type_t type;
+        int32_t arg;
+    } event_t;
+
+#ifdef ESP_PLATFORM
+    static QueueHandle_t queue = NULL;
+
+    void begin(){
+        if(queue == NULL){
+            queue = xQueueCreate(REACTOR_QUEUE_SIZE, sizeof(event_t));
+        }
+    }
+
+    // 이벤트 핸들러 및 다른 태스크에서 호출, 큐가 가득 찼으면 버림
+    bool post(event_type_t type, int32_t arg = 0){
+        if(queue == NULL){
+            return false;
+        }
+        event_t event = {type, arg};
+        return xQueueSend(queue, &event, 0) == pdTRUE;
+    }
+
+    // timeout 동안 이벤트를 기다림, 이벤트가 없으면 false
+    bool wait(event_t* event, int64_t timeoutMs){
+        TickType_t ticks = timeoutMs < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+        return xQueueReceive(queue, event, ticks) == pdTRUE;
+    }
+#else
+    // 호스트 빌드: 테스트가 wait로 직접 꺼내 처리, 기다리지 않음
+    static std::mutex mutex;
+    static std::deque<event_t> queue;
+
+    void begin(){
+    }
+
+    bool post(event_type_t type, int32_t arg = 0){
+        std::lock_guard<std::mutex> guard(mutex);
+        if(queue.size() >= REACTOR_QUEUE_SIZE){
+            return false;
+        }
+        queue.push_back({type, arg});
+        return true;
+    }
+
+    bool wait(event_t* event, int64_t timeoutMs){
+        std::lock_guard<std::mutex> guard(mutex);
+        if(queue.empty()){
+            return false;
+        }
+        *event = queue.front();
+        queue.pop_front();
+        return true;
+    }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace std;
+
+// 다중 생산자, 단일 소비자 고정 크기 링 버퍼(lock-free, 할당 없음)
+// 각 칸의 sequence로 생산자끼리의 경쟁과 소비자와의 동기화를 처리
+template<typename T, uint32_t SIZE>
+class Ring{
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+
+    struct Cell{
+        atomic<uint32_t> sequence;
+        T item;
+    };
+
+    Cell cells[SIZE];
+    atomic<uint32_t> head; // 다음에 쓸 위치(생산자)
+    atomic<uint32_t> tail; // 다음에 읽을 위치(소비자)
+
+public:
+    Ring(): head(0), tail(0){
+        for(uint32_t i = 0; i < SIZE; ++i){
+            cells[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+
+    // 빈 칸을 예약해 fill(T&)로 직접 채움, 가득 찼으면 false
+    template<typename F>
+    bool emplace(F fill){
+        uint32_t pos = head.load(memory_order_relaxed);
+        Cell* cell;
+        for(;;){
+            cell = &cells[pos & (SIZE - 1)];
+            int32_t diff = (int32_t) (cell->sequence.load(memory_order_acquire) - pos);
+            if(diff == 0){
+                if(head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)){
+                    break;
+                }
+            }else if(diff < 0){
+                return false;
+            }else{
+                pos = head.load(memory_order_relaxed);
+            }
+        }
+        fill(cell->item);
+        cell->sequence.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    bool push(const T& item){
+        return emplace([&](T& slot){ slot = item; });
+    }
+
+    // 소비자 전용, 비어있으면 NULL
+    T* front(){
+        uint32_t pos = tail.load(memory_order_relaxed);
+        Cell* cell = &cells[pos & (SIZE - 1)];
+        if((int32_t) (cell->sequence.load(memory_order_acquire) - (pos + 1)) < 0){
+            return NULL;
+        }
+        return &cell->item;
+    }
+
+    // 소비자 전용, front()로 확인한 항목을 반환
+    void pop(){
+        uint32_t pos = tail.load(memory_order_relaxed);
+        cells[pos & (SIZE - 1)].sequence.store(pos + SIZE, memory_order_release);
+        tail.store(pos + 1, memory_order_relaxed);
+    }
+
+    uint32_t size() const{
+        return head.load(memory_order_relaxed) - tail.load(memory_order_relaxed);
+    }
+
+    static constexpr uint32_t capacity(){
+        return SIZE;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <time.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <driver/ledc.h>
+
+#include "logger.h"
+#include "storage.h"
+#include "reactor.h"
+#include "switches.h"
+#include "timesync.h"
+#include "protocol.h"
+
+#define SCHEDULE_MAX_WAIT 3600 // s, SNTP 보정으로 시각이 바뀌어도 이 간격마다 다시 계산
+#define SCHEDULE_LATE_LIMIT 300 // s, 시각이 크게 바뀌어 이보다 늦게 확인된 일정은 실행하지 않음
+#define SCHEDULE_RETRY 1000 // ms, 이벤트 큐가 가득 찼을 때 재시도
+
+// 기기에 저장된 일정을 서버 없이 실행, 일정은 storage에 저장되어 재부팅 후에도 유지
+// 가장 먼저 실행될 일정 하나에만 esp_timer를 맞추고, 실행은 deviceTask에서 처리(주기적으로 확인하지 않음)
+// 타이머 휠 대신 단일 타이머: 일정이 PROTOCOL_MAX_SCHEDULES개 이하라 다음 시각은 매번 전체를 계산해도 충분하고,
+// 휠처럼 칸마다 깨어나지 않으므로 다음 일정(최대 SCHEDULE_MAX_WAIT)까지 light sleep, deep sleep이 끊기지 않음
+// 자동 light sleep 중에도 esp_timer가 기기를 깨움
+namespace schedule{
+    typedef bool (*apply_t)(ledc_channel_t channel, bool state, protocol::origin_t origin);
+
+    static esp_timer_handle_t timer = NULL;
+    static apply_t apply = NULL;
+    static RTC_DATA_ATTR time_t lastCheck = 0; // deviceTask에서만 사용, 0이면 아직 확인한 적 없음, deep sleep 중에도 유지
+
+    // after보다 뒤에 처음 실행될 시각(현지 시각 기준), 없으면 -1
+    static time_t nextAfter(const protocol::schedule_entry_t& entry, time_t after){
+        tm local;
+        localtime_r(&after, &local);
+        for(uint8_t day = 0; day <= 7; ++day){
+            tm candidate = local;
+            candidate.tm_mday += day;
+            candidate.tm_hour = entry.minute / 60;
+            candidate.tm_min = entry.minute % 60;
+            candidate.tm_sec = 0;
+            candidate.tm_isdst = -1;
+            time_t due = mktime(&candidate); // 날짜를 정규화하며 tm_wday도 계산됨
+            if(due > after && (entry.days == 0 || (entry.days & (1 << candidate.tm_wday)))){
+                return due;
+            }
+        }
+        return -1;
+    }
+
+    inline bool valid(const protocol::schedule_entry_t& entry){
+        return entry.minute < 24 * 60 && entry.days < 0x80 && switches::valid(entry.channel) && entry.action <= protocol::SCHEDULE_TOGGLE;
+    }
+
+    // 가장 먼저 실행될 일정 시각(UNIX, s), 시각을 모르거나 일정이 없으면 -1
+    time_t nextDue(){
+        if(!timesync::valid()){
+            return -1;
+        }
+        protocol::schedule_entry_t entries[PROTOCOL_MAX_SCHEDULES];
+        uint8_t count = storage::getSchedules(entries);
+        time_t now = time(NULL);
+        time_t next = -1;
+        for(uint8_t i = 0; i < count; ++i){
+            time_t due = nextAfter(entries[i], now);
+            if(due > 0 && (next < 0 || due < next)){
+                next = due;
+            }
+        }
+        return next;
+    }
+
+    static void arm(){
+        esp_timer_stop(timer);
+        time_t next = nextDue();
+        if(next < 0){
+            return;
+        }
+        // time()은 초 미만을 버리므로 타이머는 실행 시각보다 일찍 끝나지 않음
+        int64_t wait = MIN(next - time(NULL), SCHEDULE_MAX_WAIT);
+        esp_timer_start_once(timer, MAX(wait, 1) * 1000000LL);
+    }
+
+    static void fire(const protocol::schedule_entry_t& entry){
+        bool state = entry.action == protocol::SCHEDULE_TOGGLE ? !switches::get(entry.channel) : entry.action == protocol::SCHEDULE_ON;
+        LOG_INFO("[Schedule] %u번 일정 실행, %u번 스위치 %s", entry.id, entry.channel, state ? "켜짐" : "꺼짐");
+        apply((ledc_channel_t) entry.channel, state, protocol::ORIGIN_SCHEDULE);
+        if(entry.days == 0){
+            storage::removeSchedule(entry);
+        }
+    }
+
+    // SCHEDULE_DUE, TIME_SYNCED마다 deviceTask에서 호출, 직전 확인 이후 시각이 지난 일정을 실행하고 타이머를 다시 맞춤
+    void run(){
+        if(apply == NULL || !timesync::valid()){
+            return; // 동기화되면 TIME_SYNCED로 다시 호출됨
+        }
+
+        time_t now = time(NULL);
+        if(lastCheck > 0 && now > lastCheck){
+            protocol::schedule_entry_t entries[PROTOCOL_MAX_SCHEDULES];
+            uint8_t count = storage::getSchedules(entries);
+            for(uint8_t i = 0; i < count; ++i){
+                time_t due = nextAfter(entries[i], lastCheck);
+                if(due > 0 && due <= now && now - due <= SCHEDULE_LATE_LIMIT){
+                    fire(entries[i]);
+                }
+            }
+        }
+        lastCheck = now;
+        arm();
+    }
+
+    // 전체 교체, 범위를 벗어난 항목이 있으면 반영하지 않고 false
+    bool set(const protocol::schedule_t& schedule){
+        for(uint8_t i = 0; i < schedule.count; ++i){
+            if(!valid(schedule.entries[i])){
+                return false;
+            }
+        }
+        storage::setSchedules(schedule.entries, schedule.count);
+        reactor::post(reactor::SCHEDULE_DUE);
+        LOG_INFO("[Schedule] 일정 %u개 저장", schedule.count);
+        return true;
+    }
+
+    bool encode(protocol::Writer& writer, uint16_t sequence){
+        protocol::schedule_t schedule = {
+            .sequence = sequence,
+            .flags = (uint8_t) (timesync::synced ? protocol::SCHEDULE_TIME_SYNCED : 0),
+            .time = (uint32_t) time(NULL),
+        };
+        schedule.count = storage::getSchedules(schedule.entries);
+        return protocol::encodeSchedule(writer, schedule);
+    }
+
+    static void timerCallback(void* args){
+        if(!reactor::post(reactor::SCHEDULE_DUE)){
+            esp_timer_start_once(timer, SCHEDULE_RETRY * 1000ULL);
+        }
+    }
+
+    // storage::begin 이후 호출, 첫 확인은 deviceTask가 시작되면 처리됨
+    void begin(apply_t callback){
+        if(timer != NULL){
+            return;
+        }
+        apply = callback;
+        esp_timer_create_args_t args = {
+            .callback = timerCallback,
+            .name = "schedule",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+        reactor::post(reactor::SCHEDULE_DUE);
+    }
+}
\ No newline at end of file
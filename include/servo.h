@@ -1,17 +1,168 @@
 #pragma once
 
+#include <atomic>
+#include <esp_timer.h>
 #include <driver/ledc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
 
-#define FREQUENCY 50
-#define MAX_ANGLE 180
-#define MIN_WIDTH_US 500
-#define MAX_WIDTH_US 2500
+#include "power.h"
+#include "stats.h"
+#include "config.h"
+#include "reactor.h"
 
 namespace servo{
+    typedef config::profile_t profile_t;
+
+    typedef enum{
+        IDLE,
+        RAMP,
+        HOLD,
+        RELEASE,
+    } phase_t;
+
+    // 단계와 세대(move마다 1 증가)를 한 값으로 묶어 CAS, 이전 동작의 페이드 완료, 유지 시간 종료가 늦게 도착해도 새 동작에 반영되지 않음
+    // 형식: generation(24비트) << 2 | phase
+    // LEDC 조작(move의 실제 구동, 도착, 유지 시간 종료, turnOff)은 모두 타이머 데몬 태스크에서 차례로 실행
+    typedef struct{
+        uint32_t duty;
+        profile_t profile;
+    } target_t;
+
+    static esp_timer_handle_t holdTimer[LEDC_CHANNEL_MAX] = {NULL};
+    static atomic<uint32_t> phases[LEDC_CHANNEL_MAX];
+    static target_t targets[LEDC_CHANNEL_MAX]; // move가 쓰고 데몬 태스크가 읽음(targetLock)
+    static portMUX_TYPE targetLock = portMUX_INITIALIZER_UNLOCKED;
+    // 이하 데몬 태스크 전용
+    static profile_t profiles[LEDC_CHANNEL_MAX];
+    static volatile uint32_t fadeGeneration[LEDC_CHANNEL_MAX] = {0}; // 진행 중인 페이드의 세대, 완료 인터럽트가 읽음
+    static volatile uint32_t holdGeneration[LEDC_CHANNEL_MAX] = {0};
+    static atomic<bool> active[LEDC_CHANNEL_MAX]; // PWM 출력 중에는 라이트 슬립, APB 클럭 변경을 막음
+    static uint32_t lastDuty[LEDC_CHANNEL_MAX] = {0}; // 페이드 시작점, 0이면 위치를 모름
+
+    inline uint32_t word(uint32_t generation, phase_t phase){
+        return (generation & 0xFFFFFF) << 2 | phase;
+    }
+
+    inline uint32_t generationOf(uint32_t word){
+        return word >> 2;
+    }
+
+    inline phase_t phaseOf(uint32_t word){
+        return (phase_t) (word & 0x03);
+    }
+
+    // 데몬 태스크로 넘기는 인자: generation << 8 | channel
+    inline uint32_t deferred(ledc_channel_t channel, uint32_t generation){
+        return (generation & 0xFFFFFF) << 8 | channel;
+    }
+
+    // generation의 from 단계일 때만 to로 바꿈
+    static bool advance(ledc_channel_t channel, uint32_t generation, phase_t from, phase_t to){
+        uint32_t expected = word(generation, from);
+        return phases[channel].compare_exchange_strong(expected, word(generation, to));
+    }
+
+    static void turnOff(ledc_channel_t channel);
+
+    // 도착 처리, time이 0이면 페이드 없이 즉시 이동하고 바로 다음 단계로 넘어감
+    static void fadeTo(ledc_channel_t channel, uint32_t generation, uint32_t duty, uint16_t time);
+
+    static void arrived(ledc_channel_t channel, uint32_t generation){
+        if(advance(channel, generation, RAMP, HOLD)){
+            holdGeneration[channel] = generation;
+            esp_timer_stop(holdTimer[channel]);
+            esp_timer_start_once(holdTimer[channel], profiles[channel].holdTime * 1000ULL);
+            reactor::post(reactor::SERVO_SETTLED, channel);
+        }else if(advance(channel, generation, RELEASE, IDLE)){
+            turnOff(channel);
+        }
+    }
+
+    // 유지 시간 종료
+    static void holdDeferred(void* args, uint32_t arg){
+        ledc_channel_t channel = (ledc_channel_t) (arg & 0xFF);
+        uint32_t generation = arg >> 8;
+        if(profiles[channel].releaseDuty == 0){
+            if(advance(channel, generation, HOLD, IDLE)){
+                turnOff(channel);
+            }
+        }else if(advance(channel, generation, HOLD, RELEASE)){
+            fadeTo(channel, generation, profiles[channel].releaseDuty, profiles[channel].releaseTime);
+        }
+    }
+
+    static void holdCallback(void* args){
+        ledc_channel_t channel = (ledc_channel_t) (intptr_t) args;
+        xTimerPendFunctionCall(holdDeferred, NULL, deferred(channel, holdGeneration[channel]), portMAX_DELAY);
+    }
+
+    static void arrivedDeferred(void* args, uint32_t arg){
+        ledc_channel_t channel = (ledc_channel_t) (arg & 0xFF);
+        // 정지한 페이드의 완료가 새 페이드 시작 뒤에 도착한 경우 목표 duty가 다름
+        if(ledc_get_duty(LEDC_LOW_SPEED_MODE, channel) != lastDuty[channel]){
+            return;
+        }
+        arrived(channel, arg >> 8);
+    }
+
+    // 페이드 완료 인터럽트, 처리는 타이머 데몬 태스크로 넘김
+    static bool IRAM_ATTR fadeCallback(const ledc_cb_param_t* param, void* args){
+        if(param->event != LEDC_FADE_END_EVT){
+            return false;
+        }
+        BaseType_t woken = pdFALSE;
+        ledc_channel_t channel = (ledc_channel_t) param->channel;
+        xTimerPendFunctionCallFromISR(arrivedDeferred, NULL, deferred(channel, fadeGeneration[channel]), &woken);
+        return woken == pdTRUE;
+    }
+
+    static void fadeTo(ledc_channel_t channel, uint32_t generation, uint32_t duty, uint16_t time){
+        if(time == 0 || lastDuty[channel] == 0){
+            // 현재 위치를 모르면 0 duty에서 페이드하지 않도록 바로 이동
+            ESP_ERROR_CHECK(ledc_set_duty(LEDC_LOW_SPEED_MODE, channel, duty));
+            ESP_ERROR_CHECK(ledc_update_duty(LEDC_LOW_SPEED_MODE, channel));
+            lastDuty[channel] = duty;
+            arrived(channel, generation);
+            return;
+        }
+        if(ledc_get_duty(LEDC_LOW_SPEED_MODE, channel) == 0){
+            ESP_ERROR_CHECK(ledc_set_duty(LEDC_LOW_SPEED_MODE, channel, lastDuty[channel]));
+            ESP_ERROR_CHECK(ledc_update_duty(LEDC_LOW_SPEED_MODE, channel));
+        }
+        lastDuty[channel] = duty;
+        fadeGeneration[channel] = generation;
+        ESP_ERROR_CHECK(ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, channel, duty, time));
+        ESP_ERROR_CHECK(ledc_fade_start(LEDC_LOW_SPEED_MODE, channel, LEDC_FADE_NO_WAIT));
+    }
+
+    // move의 실제 구동, 그 사이 다시 move가 호출되었으면 마지막 호출의 구동만 실행
+    static void moveDeferred(void* args, uint32_t arg){
+        ledc_channel_t channel = (ledc_channel_t) (arg & 0xFF);
+        uint32_t generation = arg >> 8;
+        taskENTER_CRITICAL(&targetLock);
+        bool current = generationOf(phases[channel]) == generation;
+        target_t target = targets[channel];
+        taskEXIT_CRITICAL(&targetLock);
+        if(!current){
+            return;
+        }
+
+        if(!active[channel].exchange(true)){
+            power::acquire(power::SERVO);
+        }
+        esp_timer_stop(holdTimer[channel]);
+#if SOC_LEDC_SUPPORT_FADE_STOP
+        ledc_fade_stop(LEDC_LOW_SPEED_MODE, channel);
+#endif
+        profiles[channel] = target.profile;
+        fadeTo(channel, generation, target.duty, target.profile.rampTime);
+    }
+
     void init(ledc_channel_t channel, gpio_num_t pin){
         ledc_timer_config_t ledc_timer = {
             .speed_mode = LEDC_LOW_SPEED_MODE,
-            .duty_resolution = LEDC_TIMER_10_BIT,
+            .duty_resolution = (ledc_timer_bit_t) DUTY_BITS,
             .timer_num = LEDC_TIMER_0,
             .freq_hz = FREQUENCY,
             .clk_cfg = LEDC_AUTO_CLK,
@@ -28,20 +179,60 @@ namespace servo{
             .hpoint = 0,
         };
         ESP_ERROR_CHECK(ledc_channel_config(&ledc_ch));
+
+        static bool fadeInstalled = false;
+        if(!fadeInstalled){
+            ESP_ERROR_CHECK(ledc_fade_func_install(0));
+            fadeInstalled = true;
+        }
+        ledc_cbs_t callbacks = {
+            .fade_cb = fadeCallback,
+        };
+        ESP_ERROR_CHECK(ledc_cb_register(LEDC_LOW_SPEED_MODE, channel, &callbacks, NULL));
+
+        esp_timer_create_args_t args = {
+            .callback = holdCallback,
+            .arg = (void*) (intptr_t) channel,
+            .name = "servo_hold",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &holdTimer[channel]));
     }
 
-    void setAngle(ledc_channel_t channel, float angle){
-        float angle_us = angle / MAX_ANGLE * (MAX_WIDTH_US - MIN_WIDTH_US) + MIN_WIDTH_US;
-        ESP_ERROR_CHECK(ledc_set_duty(
-            LEDC_LOW_SPEED_MODE,
-            channel,
-            (uint32_t) (angle_us * ((1 << LEDC_TIMER_10_BIT) - 1) * FREQUENCY / (1000000.0f))
-        ));
-        ESP_ERROR_CHECK(ledc_update_duty(LEDC_LOW_SPEED_MODE, channel));
+    // profile에 따라 duty(config::dutyOf)로 이동, 진행 중인 동작은 취소됨
+    // 세대만 바꾸고 구동은 타이머 데몬 태스크에서 실행, 반환 즉시 moving()이 true
+    void move(ledc_channel_t channel, uint32_t duty, const profile_t& profile){
+        stats::servoTime[channel] = esp_timer_get_time();
+
+        taskENTER_CRITICAL(&targetLock);
+        uint32_t generation = generationOf(phases[channel]) + 1;
+        phases[channel] = word(generation, RAMP);
+        targets[channel] = {duty, profile};
+        taskEXIT_CRITICAL(&targetLock);
+        xTimerPendFunctionCall(moveDeferred, NULL, deferred(channel, generation), portMAX_DELAY);
+    }
+
+    // 목표 위치로 이동 중인지, 이동 중에 바뀐 상태는 도착(SERVO_SETTLED) 후 마지막 값만 반영
+    bool moving(ledc_channel_t channel){
+        return phaseOf(phases[channel]) == RAMP;
+    }
+
+    // PWM 출력 중이거나 구동을 기다리는 채널이 있는지
+    bool busy(){
+        for(uint8_t i = 0; i < LEDC_CHANNEL_MAX; ++i){
+            if(active[i] || phaseOf(phases[i]) != IDLE){
+                return true;
+            }
+        }
+        return false;
     }
 
-    void turnOff(ledc_channel_t channel){
+    // 데몬 태스크에서 IDLE로 바꾼 뒤 호출
+    static void turnOff(ledc_channel_t channel){
         ESP_ERROR_CHECK(ledc_set_duty(LEDC_LOW_SPEED_MODE, channel, 0));
         ESP_ERROR_CHECK(ledc_update_duty(LEDC_LOW_SPEED_MODE, channel));
+        if(active[channel].exchange(false)){
+            power::release(power::SERVO);
+            stats::record(stats::SERVO_TO_OFF, stats::servoTime[channel]);
+        }
     }
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#ifdef ESP_PLATFORM
+#include <esp_attr.h>
+#endif
+
+#include "hal.h"
+#include "utils.h"
+#include "power.h"
+#include "config.h"
+#include "latency.h"
+#include "protocol.h"
+
+namespace stats{
+    // 명령 수신 -> 상태 변경 -> 서보 구동 -> 서보 종료, 터치, 연결까지의 구간
+    typedef enum{
+        COMMAND_TO_STATE, // webSocketHandler 수신 ~ changeSwitchState
+        STATE_TO_SERVO, // changeSwitchState ~ servo::move
+        SERVO_TO_OFF, // servo::move ~ servo::turnOff(페이드 + 유지 시간)
+        TOUCH_TO_STATE, // 터치 감지 ~ changeSwitchState 완료
+        WIFI_CONNECT, // WiFi 시작 ~ IP 획득
+        SERVER_CONNECT, // IP 획득 ~ 서버 인증 완료
+        WAKE_TO_ACTUATION, // deep sleep 터치 wake ~ 서보 구동(부트로더 추정치 포함)
+        WAKE_TO_REPORT, // deep sleep wake ~ 서버 인증 완료(부트로더 추정치 포함)
+        STAGE_MAX,
+    } stage_t;
+
+    // deep sleep 모드에서는 깨어날 때마다 한 번씩 기록되므로 RTC 메모리에 누적
+#if POWER_MODE == POWER_MODE_DEEP_SLEEP && defined(ESP_PLATFORM)
+    RTC_DATA_ATTR latency::Histogram histograms[STAGE_MAX];
+#else
+    latency::Histogram histograms[STAGE_MAX];
+#endif
+
+    // 구간 시작 시각(us), 채널별로 한 태스크가 쓰고 다른 태스크가 읽음
+    static volatile int64_t stateTime[SWITCH_CHANNELS] = {0};
+    static volatile int64_t servoTime[SWITCH_CHANNELS] = {0};
+    static volatile int64_t wifiTime = 0;
+
+    // 시작 시각 대신 지난 시간(us)을 직접 기록
+    void add(stage_t stage, int64_t elapsed){
+        histograms[stage].record((uint32_t) MIN(MAX(elapsed, 0), (int64_t) UINT32_MAX));
+    }
+
+    // start부터 현재까지를 기록, start가 없으면(0) 무시
+    void record(stage_t stage, int64_t start){
+        if(start <= 0){
+            return;
+        }
+        add(stage, hal::micros() - start);
+    }
+
+    void reset(){
+        for(uint8_t i = 0; i < STAGE_MAX; ++i){
+            histograms[i].reset();
+        }
+    }
+
+    bool encode(protocol::Writer& writer, uint16_t sequence){
+        // 기록이 없는 구간은 생략(전원 모드에 따라 쓰지 않는 구간이 있음)
+        protocol::stage_stats_t stages[STAGE_MAX];
+        uint8_t count = 0;
+        for(uint8_t i = 0; i < STAGE_MAX; ++i){
+            if(histograms[i].count.load() == 0){
+                continue;
+            }
+            stages[count++] = {
+                .stage = i,
+                .count = histograms[i].count.load(),
+                .p50 = histograms[i].percentile(500),
+                .p90 = histograms[i].percentile(900),
+                .p99 = histograms[i].percentile(990),
+                .max = histograms[i].max.load(),
+            };
+        }
+        return protocol::encodeStats(writer, sequence, stages, count);
+    }
+}
\ No newline at end of file
@@ -1,70 +1,251 @@
 #pragma once
 
-#include <nvs.h>
-#include <string>
+#include <stddef.h>
+#include <string.h>
 
-using namespace std;
+#include "hal.h"
+#include "utils.h"
+#include "reactor.h"
+#include "protocol.h"
+
+#define STORAGE_KEY "config"
+#define STORAGE_VERSION 3
+#define STORAGE_FLUSH_DELAY 3000 // 변경 후 저장까지 대기 시간(ms), 그 사이의 변경은 한 번에 저장됨
+#define STORAGE_DEVICE_ID_LENGTH 10
+
+// 설정 전체를 RAM에 두고 부팅 시 한 번에 읽음
+// 변경은 RAM에만 반영하고 STORAGE_FLUSH_DELAY 뒤 deviceTask에서 blob 하나로 저장(nvs_commit 포함)
+// NVS, 잠금, 타이머는 hal.h를 거치므로 호스트에서도 빌드 가능(메모리 NVS)
 
 namespace storage{
-    static string deviceId = "";
-    static nvs_handle_t nvsHandle;
+    // 마지막으로 연결에 성공한 AP 정보
+    typedef struct{
+        uint8_t bssid[6];
+        uint8_t channel;
+    } ap_cache_t;
+
+    typedef struct{
+        uint8_t version;
+        bool hasApCache;
+        char deviceId[STORAGE_DEVICE_ID_LENGTH + 1];
+        ap_cache_t apCache;
+        uint16_t switchStates; // 채널별 상태 비트(switches::bits)
+        // 이하 v2에서 추가, 앞부분은 v1과 같은 배치
+        uint8_t scheduleCount;
+        protocol::schedule_entry_t schedules[PROTOCOL_MAX_SCHEDULES];
+        // 이하 v3에서 추가
+        uint16_t bootEpoch; // 전원이 켜질 때마다 1 증가(deep sleep에서 깨어난 경우 제외), 스위치 버전의 상위 비트
+    } data_t;
 
-    esp_err_t begin(){
-        return nvs_open("switch_bot", NVS_READWRITE, &nvsHandle);
+    static constexpr size_t V1_SIZE = offsetof(data_t, scheduleCount);
+    static constexpr size_t V2_SIZE = offsetof(data_t, bootEpoch);
+
+    // 버전별 blob 크기, 알 수 없는 버전이면 0
+    static size_t sizeOf(uint8_t version){
+        switch(version){
+            case 1:
+                return V1_SIZE;
+            case 2:
+                return V2_SIZE;
+            case STORAGE_VERSION:
+                return sizeof(data_t);
+            default:
+                return 0;
+        }
     }
 
-    uint8_t getUint8(const char* key, uint8_t def = 255){
-        uint8_t data = 0;
-        if(nvs_get_u8(nvsHandle, key, &data) != ESP_OK){
-            return def;
+    static hal::Nvs nvs;
+    static data_t data;
+    static bool dirty = false;
+    static hal::Lock lock;
+    static hal::Timer flushTimer;
+
+    static void flushCallback(void* args){
+        if(!reactor::post(reactor::STORAGE_FLUSH)){
+            flushTimer.once(STORAGE_FLUSH_DELAY * 1000ULL);
         }
-        return data;
     }
 
-    string getString(string key, size_t length){
-        char data[length] = {0};
-        esp_err_t err = nvs_get_str(nvsHandle, key.c_str(), data, &length);
-        if(err != ESP_OK){
-            return "";
+    // 저장 예약, 이미 예약되어 있으면 기존 예약에 합쳐짐
+    static void schedule(){
+        if(flushTimer.created() && !flushTimer.active()){
+            flushTimer.once(STORAGE_FLUSH_DELAY * 1000ULL);
         }
-        return string(data);
     }
 
-    string getString(string key){
-        uint16_t lenData;
-        esp_err_t err = nvs_get_u16(nvsHandle, (key + "$l").c_str(), &lenData);
-        if(err != ESP_OK){
-            return "";
+    // 변경된 내용이 있으면 저장, 재부팅 전에는 직접 호출
+    bool flush(){
+        data_t copy;
+        lock.lock();
+        bool changed = dirty;
+        dirty = false;
+        copy = data;
+        lock.unlock();
+        if(!changed){
+            return true;
         }
-        return getString(key, lenData);
+
+        if(nvs.setBlob(STORAGE_KEY, &copy, sizeof(copy)) && nvs.commit()){
+            return true;
+        }
+        lock.lock();
+        dirty = true;
+        lock.unlock();
+        return false;
     }
 
-    bool setString(string key, string value, bool saveLength = true){
-        if(saveLength && nvs_set_u16(nvsHandle, (key + "$l").c_str(), value.length() + 1) != ESP_OK){
-            return false;
+    // 이전 버전에서 개별 키로 저장한 값을 가져오고 삭제
+    static void migrate(){
+        size_t length = sizeof(data.deviceId);
+        if(!nvs.getString("DEVICE_ID", data.deviceId, &length) || strlen(data.deviceId) != STORAGE_DEVICE_ID_LENGTH){
+            memset(data.deviceId, 0, sizeof(data.deviceId));
+        }
+        nvs.erase("DEVICE_ID");
+
+        // wifi.h가 ap_cache_t를 그대로 저장하던 값, 형식이 같아 옮겨 담음(첫 부팅에도 전체 스캔 없이 연결)
+        length = sizeof(data.apCache);
+        data.hasApCache = nvs.getBlob("wifi_cache", &data.apCache, &length) && length == sizeof(data.apCache);
+        if(!data.hasApCache){
+            memset(&data.apCache, 0, sizeof(data.apCache));
         }
-        return nvs_set_str(nvsHandle, key.c_str(), value.c_str()) == ESP_OK;
+        nvs.erase("wifi_cache");
     }
 
-    string getDeviceId(){
-        if(deviceId.length() > 0){
-            return deviceId;
+    // NVS를 열 수 없으면 false
+    bool begin(){
+        if(!nvs.open("switch_bot")){
+            return false;
+        }
+
+        size_t length = sizeof(data);
+        bool found = nvs.getBlob(STORAGE_KEY, &data, &length);
+        if(found && data.version < STORAGE_VERSION && length == sizeOf(data.version)){
+            // 추가된 필드만 초기화
+            memset((uint8_t*) &data + length, 0, sizeof(data) - length);
+            data.version = STORAGE_VERSION;
+            dirty = true;
+        }else if(!found || length != sizeof(data) || data.version != STORAGE_VERSION){
+            memset(&data, 0, sizeof(data));
+            data.version = STORAGE_VERSION;
+            migrate();
+            dirty = true;
         }
 
-        string id = getString("DEVICE_ID", 11);
-        if(id.length() == 10){
-            return deviceId = id;
-        }else{
-            stringstream stream;
+        if(strlen(data.deviceId) != STORAGE_DEVICE_ID_LENGTH){
             for(uint8_t i = 0; i < 5; ++i){
-                stream << (char) random_int('a', 'z');
+                data.deviceId[i] = random_int('a', 'z');
             }
-            stream << '_';
-            for(uint8_t i = 0; i < 4; ++i){
-                stream << (char) random_int('0', '9');
+            data.deviceId[5] = '_';
+            for(uint8_t i = 6; i < STORAGE_DEVICE_ID_LENGTH; ++i){
+                data.deviceId[i] = random_int('0', '9');
             }
-            setString("DEVICE_ID", deviceId = stream.str(), false);
+            data.deviceId[STORAGE_DEVICE_ID_LENGTH] = '\0';
+            dirty = true;
+        }
+        flush();
+        return flushTimer.create(flushCallback, "storage_flush");
+    }
+
+    // 부팅 후 바뀌지 않음
+    const char* getDeviceId(){
+        return data.deviceId;
+    }
+
+    // 전원이 켜질 때 한 번 호출, 스위치 버전이 이전 부팅보다 커지도록 바로 저장(저장에 실패하면 다음 flush에서 다시 시도)
+    uint16_t nextEpoch(){
+        lock.lock();
+        uint16_t epoch = ++data.bootEpoch;
+        dirty = true;
+        lock.unlock();
+        flush();
+        return epoch;
+    }
+
+    bool getApCache(ap_cache_t* cache){
+        lock.lock();
+        bool exists = data.hasApCache;
+        *cache = data.apCache;
+        lock.unlock();
+        return exists;
+    }
+
+    void setApCache(const ap_cache_t& cache){
+        lock.lock();
+        bool changed = !data.hasApCache || memcmp(&data.apCache, &cache, sizeof(cache)) != 0;
+        data.hasApCache = true;
+        data.apCache = cache;
+        dirty |= changed;
+        lock.unlock();
+        if(changed){
+            schedule();
+        }
+    }
+
+    void clearApCache(){
+        lock.lock();
+        bool changed = data.hasApCache;
+        data.hasApCache = false;
+        dirty |= changed;
+        lock.unlock();
+        if(changed){
+            schedule();
+        }
+    }
+
+    uint16_t getSwitchStates(){
+        lock.lock();
+        uint16_t states = data.switchStates;
+        lock.unlock();
+        return states;
+    }
+
+    void setSwitchStates(uint16_t states){
+        lock.lock();
+        bool changed = data.switchStates != states;
+        data.switchStates = states;
+        dirty |= changed;
+        lock.unlock();
+        if(changed){
+            schedule();
+        }
+    }
+
+    uint8_t getSchedules(protocol::schedule_entry_t* entries){
+        lock.lock();
+        uint8_t count = data.scheduleCount;
+        memcpy(entries, data.schedules, count * sizeof(protocol::schedule_entry_t));
+        lock.unlock();
+        return count;
+    }
+
+    void setSchedules(const protocol::schedule_entry_t* entries, uint8_t count){
+        lock.lock();
+        bool changed = data.scheduleCount != count || memcmp(data.schedules, entries, count * sizeof(protocol::schedule_entry_t)) != 0;
+        data.scheduleCount = count;
+        memcpy(data.schedules, entries, count * sizeof(protocol::schedule_entry_t));
+        dirty |= changed;
+        lock.unlock();
+        if(changed){
+            schedule();
+        }
+    }
+
+    // 실행을 마친 일회성 일정 삭제, 그 사이 일정이 교체되었으면 같은 항목이 없으므로 무시됨
+    void removeSchedule(const protocol::schedule_entry_t& entry){
+        lock.lock();
+        bool changed = false;
+        for(uint8_t i = 0; i < data.scheduleCount; ++i){
+            if(memcmp(&data.schedules[i], &entry, sizeof(entry)) == 0){
+                memmove(&data.schedules[i], &data.schedules[i + 1], (data.scheduleCount - i - 1) * sizeof(entry));
+                --data.scheduleCount;
+                changed = true;
+                break;
+            }
+        }
+        dirty |= changed;
+        lock.unlock();
+        if(changed){
+            schedule();
         }
-        return deviceId;
     }
 }
\ No newline at end of file
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "hal.h"
+#include "config.h"
+#include "protocol.h"
+
+#define SWITCH_EPOCH_SHIFT 16 // 버전 상위 12비트: 부팅 번호(storage::nextEpoch), 하위 16비트: 부팅 후 변경 횟수
+
+using namespace std;
+
+// 스위치 상태, 버전, 변경 주체, 마지막 변경 시각(호스트에서 빌드 가능)
+// 채널마다 64비트 값 하나로 묶어 CAS로 갱신하므로 터치, 웹소켓, LAN, 일정이 동시에 바꿔도 항목끼리 어긋나지 않음
+// 형식: time(ms, u32) << 32 | version(28비트) << 4 | origin(3비트) << 1 | state
+// ESP32-S3는 64비트 CAS 명령이 없어 짧은 임계 구역으로 처리됨(ISR에서는 사용하지 않음)
+namespace switches{
+    typedef protocol::origin_t origin_t;
+
+    typedef enum{
+        APPLIED,
+        UNCHANGED, // 이미 같은 상태
+        STALE, // base version 이후의 변경이 있어 버림
+    } result_t;
+
+    typedef struct{
+        bool state;
+        uint8_t origin; // origin_t
+        uint32_t version; // 상태가 바뀔 때마다 1씩 증가, 부팅 시 epochVersion(deep sleep에서 깨어나면 잠들기 전 값)
+        uint32_t time; // ms(hal::millis 하위 32비트)
+    } snapshot_t;
+
+    static atomic<uint64_t> words[SWITCH_CHANNELS];
+
+    inline uint64_t pack(const snapshot_t& snapshot){
+        return ((uint64_t) snapshot.time << 32) | ((snapshot.version & 0x0FFFFFFF) << 4) | ((snapshot.origin & 0x07) << 1) | (snapshot.state ? 1 : 0);
+    }
+
+    inline snapshot_t unpack(uint64_t word){
+        return {
+            .state = (bool) (word & 0x01),
+            .origin = (uint8_t) ((word >> 1) & 0x07),
+            .version = (uint32_t) (word >> 4) & 0x0FFFFFFF,
+            .time = (uint32_t) (word >> 32),
+        };
+    }
+
+    inline bool valid(uint8_t channel){
+        return channel < SWITCH_CHANNELS;
+    }
+
+    inline snapshot_t load(uint8_t channel){
+        return unpack(valid(channel) ? words[channel].load() : 0);
+    }
+
+    inline bool get(uint8_t channel){
+        return load(channel).state;
+    }
+
+    // 부팅 시 시작 버전, 이전 부팅에서 만든 버전보다 큼(부팅마다 변경이 2^16번 미만일 때, 4096번 부팅마다 한 바퀴)
+    inline uint32_t epochVersion(uint16_t epoch){
+        return ((uint32_t) epoch << SWITCH_EPOCH_SHIFT) & 0x0FFFFFFF;
+    }
+
+    // 부팅 시 저장된 상태로 초기화, 변경이 아니므로 버전을 올리지 않음
+    // 시각은 lockout보다 충분히 이전으로 두어 부팅 직후 터치가 막히지 않음
+    inline void restore(uint8_t channel, bool state, uint32_t version){
+        if(valid(channel)){
+            words[channel] = pack({state, protocol::ORIGIN_RESTORE, version, (uint32_t) hal::millis() - UINT16_MAX});
+        }
+    }
+
+    // 현재 값에서 다음 값을 계산해 CAS, next가 false를 반환하면 바꾸지 않음
+    template<typename F>
+    inline bool update(uint8_t channel, F next){
+        uint64_t expected = words[channel].load();
+        for(;;){
+            snapshot_t snapshot = unpack(expected);
+            if(!next(snapshot)){
+                return false;
+            }
+            ++snapshot.version;
+            snapshot.time = (uint32_t) hal::millis();
+            if(words[channel].compare_exchange_weak(expected, pack(snapshot))){
+                return true;
+            }
+        }
+    }
+
+    // 상태가 바뀌었으면 true, 나중에 도착한 쪽이 이김
+    inline bool set(uint8_t channel, bool state, origin_t origin = protocol::ORIGIN_RESTORE){
+        return valid(channel) && update(channel, [&](snapshot_t& snapshot){
+            if(snapshot.state == state){
+                return false;
+            }
+            snapshot.state = state;
+            snapshot.origin = origin;
+            return true;
+        });
+    }
+
+    // 서버가 base version을 보고 보낸 명령, base가 현재 버전이 아니면 STALE
+    // 버전은 재부팅해도 줄어들지 않으므로 base가 더 크면 이 기기가 만든 적 없는 버전(서버가 상태를 다시 받아야 함)
+    inline result_t setIf(uint8_t channel, bool state, origin_t origin, uint32_t base){
+        result_t result = UNCHANGED;
+        if(!valid(channel)){
+            return result;
+        }
+        update(channel, [&](snapshot_t& snapshot){
+            if(snapshot.version != base){
+                result = STALE;
+                return false;
+            }
+            if(snapshot.state == state){
+                result = UNCHANGED;
+                return false;
+            }
+            snapshot.state = state;
+            snapshot.origin = origin;
+            result = APPLIED;
+            return true;
+        });
+        return result;
+    }
+
+    // 마지막 변경 후 lockout(ms)이 지났을 때만 반전, 확인과 반전 사이에 다른 변경이 끼어들지 않음
+    inline bool toggle(uint8_t channel, uint32_t lockout, origin_t origin, bool& state){
+        uint32_t now = (uint32_t) hal::millis();
+        return valid(channel) && update(channel, [&](snapshot_t& snapshot){
+            if(now - snapshot.time < lockout){
+                return false;
+            }
+            snapshot.state = state = !snapshot.state;
+            snapshot.origin = origin;
+            return true;
+        });
+    }
+
+    // 마지막 변경 후 lockout(ms)이 지났는지 확인(터치 연속 입력 방지)
+    inline bool canToggle(uint8_t channel, uint32_t lockout){
+        return valid(channel) && (uint32_t) hal::millis() - load(channel).time >= lockout;
+    }
+
+    inline bool canToggle(uint8_t channel){
+        return valid(channel) && canToggle(channel, config::CHANNELS[channel].lockout);
+    }
+
+    // 채널별 상태를 비트로 묶음(bit 0: 채널 0)
+    inline uint16_t bits(){
+        uint16_t result = 0;
+        for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+            result |= (words[i].load() & 0x01) << i;
+        }
+        return result;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <esp_wifi.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+
+#include "wifi.h"
+#include "touch.h"
+#include "outbox.h"
+#include "battery.h"
+#include "reactor.h"
+#include "protocol.h"
+#include "websocket.h"
+
+#ifndef TELEMETRY_INTERVAL
+#define TELEMETRY_INTERVAL 60000 // 측정, 전송 주기(ms), 바뀐 필드가 없으면 전송하지 않음
+#endif
+#define TELEMETRY_KEYFRAME_INTERVAL 30 // 절대값 프레임 간격(전송한 프레임 수)
+
+namespace telemetry{
+    // 직전 전송값과의 차이가 이 값 이상일 때만 전송(측정 잡음으로 매번 전송되는 것을 막음)
+    static constexpr int32_t deadbands[protocol::TELEMETRY_FIELD_MAX] = {
+        3, // RSSI
+        2048, // HEAP_FREE
+        1, // HEAP_MIN
+        3600, // UPTIME, 키프레임 사이에는 한 시간 단위
+        1, // WIFI_CONNECTS
+        1, // SOCKET_CONNECTS
+        20, // BATTERY_MV
+        200, 200, 200, 200, // TOUCH_BASELINE
+    };
+
+    static esp_timer_handle_t timer = NULL;
+    static int32_t lastValues[protocol::TELEMETRY_FIELD_MAX]; // 서버가 알고 있는 값
+    static uint32_t frameCount = 0; // deviceTask에서만 사용
+    static bool keyframe = true;
+
+    // 측정한 필드를 마스크로 반환
+    static uint32_t sample(int32_t* values){
+        uint32_t mask = 0;
+        auto set = [&](uint8_t field, int32_t value){
+            values[field] = value;
+            mask |= 1 << field;
+        };
+
+        wifi_ap_record_t info;
+        if(esp_wifi_sta_get_ap_info(&info) == ESP_OK){
+            set(protocol::TELEMETRY_RSSI, info.rssi);
+        }
+        set(protocol::TELEMETRY_HEAP_FREE, esp_get_free_heap_size());
+        set(protocol::TELEMETRY_HEAP_MIN, esp_get_minimum_free_heap_size());
+        set(protocol::TELEMETRY_UPTIME, esp_timer_get_time() / 1000000);
+        set(protocol::TELEMETRY_WIFI_CONNECTS, wifi::fastConnectCount + wifi::slowConnectCount);
+        set(protocol::TELEMETRY_SOCKET_CONNECTS, ws::connectCount);
+        if(battery::milliVolt > 0){
+            set(protocol::TELEMETRY_BATTERY_MV, battery::milliVolt);
+        }
+        for(uint8_t i = 0; i < touch::padCount; ++i){
+            set(protocol::TELEMETRY_TOUCH_BASELINE + i, touch::baseline(i));
+        }
+        return mask;
+    }
+
+    // 새 세션의 첫 프레임은 절대값으로 전송
+    void resync(){
+        keyframe = true;
+    }
+
+    // 주기마다 deviceTask에서 호출, v2 서버와 연결되어 있을 때만 전송
+    void send(){
+        if(!ws::connectServer || outbox::version < 2){
+            return;
+        }
+
+        int32_t values[protocol::TELEMETRY_FIELD_MAX];
+        uint32_t available = sample(values);
+        if(!keyframe && frameCount % TELEMETRY_KEYFRAME_INTERVAL == 0){
+            keyframe = true;
+        }
+
+        protocol::telemetry_t telemetry = {
+            .flags = (uint8_t) (keyframe ? protocol::TELEMETRY_KEYFRAME : 0),
+            .mask = 0,
+        };
+        for(uint8_t i = 0; i < protocol::TELEMETRY_FIELD_MAX; ++i){
+            if(!(available & (1 << i))){
+                continue;
+            }
+            int32_t delta = values[i] - lastValues[i];
+            if(keyframe || abs(delta) >= deadbands[i]){
+                telemetry.mask |= 1 << i;
+                telemetry.values[i] = keyframe ? values[i] : delta;
+                lastValues[i] = values[i];
+            }
+        }
+        if(telemetry.mask == 0){
+            return;
+        }
+
+        telemetry.sequence = outbox::sequence++;
+        uint8_t buffer[OUTBOX_FRAME_SIZE];
+        protocol::Writer writer(buffer, sizeof(buffer));
+        // 전송하지 못하면 서버가 알고 있는 값과 달라지므로 다음에 절대값으로 전송
+        keyframe = !(protocol::encodeTelemetry(writer, telemetry) && outbox::push(buffer, writer.length));
+        ++frameCount;
+    }
+
+    static void timerCallback(void* args){
+        reactor::post(reactor::TELEMETRY_DUE);
+    }
+
+    void begin(){
+        if(timer != NULL){
+            return;
+        }
+        esp_timer_create_args_t args = {
+            .callback = timerCallback,
+            .name = "telemetry",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+        ESP_ERROR_CHECK(esp_timer_start_periodic(timer, TELEMETRY_INTERVAL * 1000ULL));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <time.h>
+#include <atomic>
+#include <stdlib.h>
+#include <esp_sntp.h>
+
+#include "logger.h"
+#include "reactor.h"
+
+#define TIMESYNC_SERVER "pool.ntp.org"
+#define TIMESYNC_TIMEZONE "KST-9" // POSIX TZ, 일정은 이 시간대 기준
+#define TIMESYNC_VALID_AFTER 1704067200 // 2024-01-01, 이전 시각이면 한 번도 동기화되지 않은 것으로 판단
+
+using namespace std;
+
+// SNTP 시각 동기화, 재동기화 주기는 CONFIG_LWIP_SNTP_UPDATE_DELAY
+// 시스템 시각은 RTC 타이머로 유지되므로 소프트웨어 재부팅, deep sleep 후에도 동기화 전까지 이전 시각을 사용
+namespace timesync{
+    atomic<bool> synced = false; // 부팅 후 동기화 여부
+
+    // 현재 시각을 일정 계산에 사용할 수 있는지
+    bool valid(){
+        return synced || time(NULL) >= TIMESYNC_VALID_AFTER;
+    }
+
+    static void syncCallback(timeval* now){
+        bool first = !synced.exchange(true);
+        reactor::post(reactor::TIME_SYNCED);
+        if(first){
+            LOG_INFO("[Time] 시각 동기화 완료: %lld", (long long) now->tv_sec);
+        }
+    }
+
+    // 시간대는 부팅 직후 설정, localtime_r이 사용
+    void setTimezone(){
+        setenv("TZ", TIMESYNC_TIMEZONE, 1);
+        tzset();
+    }
+
+    // esp_netif_init 이후 호출, WiFi가 연결되면 lwip가 알아서 요청
+    void begin(){
+        if(esp_sntp_enabled()){
+            return;
+        }
+        esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+        esp_sntp_setservername(0, TIMESYNC_SERVER);
+        sntp_set_time_sync_notification_cb(syncCallback);
+        esp_sntp_init();
+    }
+}
\ No newline at end of file
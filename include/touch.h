@@ -0,0 +1,226 @@
+#pragma once
+
+#ifdef ESP_PLATFORM
+#include <esp32-hal.h>
+#include <esp_sleep.h>
+#include <driver/touch_sensor.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#include "hal.h"
+#include "logger.h"
+#include "utils.h"
+#include "power.h"
+#include "stats.h"
+#include "detector.h"
+
+#define TOUCH_MAX_PADS 4
+#define TOUCH_RATIO 80 // ‰, 패드별 기준값 대비 터치로 판단할 증가 비율(기준값 30000이면 2400)
+#define TOUCH_MIN_MARGIN 1000 // 기준값이 작거나 읽지 못했을 때의 최소 차이
+#define TOUCH_POLL_INTERVAL 10 // 폴링 모드 측정 간격(ms)
+
+// 터치 센서 v2(ESP32-S3)에서는 하드웨어 FSM, IIR 필터, 임계값 인터럽트를 사용
+// 폴링 경로는 hal::touchRead를 거치므로 호스트에서도 빌드 가능(측정값은 테스트가 지정)
+#if defined(ESP_PLATFORM) && SOC_TOUCH_VERSION_2
+#define TOUCH_INTERRUPT_MODE 1
+#else
+#define TOUCH_INTERRUPT_MODE 0
+#endif
+
+using namespace std;
+
+namespace touch{
+    static uint8_t padCount = 0;
+    static uint8_t pins[TOUCH_MAX_PADS];
+    static volatile int64_t touchTime[TOUCH_MAX_PADS] = {0};
+
+    inline uint32_t marginOf(uint32_t baseline){
+        return detector::marginOf(baseline, TOUCH_RATIO, TOUCH_MIN_MARGIN);
+    }
+
+#if TOUCH_INTERRUPT_MODE
+    static TaskHandle_t waitTask = NULL;
+    static touch_pad_t pads[TOUCH_MAX_PADS];
+    static uint32_t margins[TOUCH_MAX_PADS]; // 패드별 임계값(기준값 대비 차이)
+
+    static void IRAM_ATTR isr(void* args){
+        if(!(touch_pad_read_intr_status_mask() & TOUCH_PAD_INTR_MASK_ACTIVE)){
+            return;
+        }
+        touch_pad_t pad = (touch_pad_t) touch_pad_get_current_meas_channel();
+        for(uint8_t i = 0; i < padCount; ++i){
+            if(pads[i] != pad){
+                continue;
+            }
+            touchTime[i] = hal::micros();
+
+            BaseType_t woken = pdFALSE;
+            xTaskNotifyFromISR(waitTask, 1 << i, eSetBits, &woken);
+            if(woken){
+                portYIELD_FROM_ISR();
+            }
+            return;
+        }
+    }
+
+    // baselines: deep sleep 전에 저장한 기준값, 있으면 필터 안정화 대기를 생략
+    // 임계값은 기준값 대비 차이이고 패드마다 기준값에 비례해 정함
+    void begin(const uint8_t* touchPins, uint8_t count, const uint32_t* baselines = NULL){
+        padCount = MIN(count, TOUCH_MAX_PADS);
+        waitTask = xTaskGetCurrentTaskHandle();
+        power::acquire(power::TOUCH);
+
+        ESP_ERROR_CHECK(touch_pad_init());
+        for(uint8_t i = 0; i < padCount; ++i){
+            pins[i] = touchPins[i];
+            pads[i] = (touch_pad_t) digitalPinToTouchChannel(pins[i]);
+            ESP_ERROR_CHECK(touch_pad_config(pads[i]));
+        }
+
+        // 하드웨어 IIR 필터가 기준값(baseline)을 계속 갱신하므로 습도, 온도 변화를 따라감
+        touch_filter_config_t filter = {
+            .mode = TOUCH_PAD_FILTER_IIR_16,
+            .debounce_cnt = 1,
+            .noise_thr = 0,
+            .jitter_step = 4,
+            .smh_lvl = TOUCH_PAD_SMOOTH_IIR_2,
+        };
+        ESP_ERROR_CHECK(touch_pad_filter_set_config(&filter));
+        ESP_ERROR_CHECK(touch_pad_filter_enable());
+
+        ESP_ERROR_CHECK(touch_pad_isr_register(isr, NULL, TOUCH_PAD_INTR_MASK_ACTIVE));
+        ESP_ERROR_CHECK(touch_pad_set_fsm_mode(TOUCH_FSM_MODE_TIMER));
+        ESP_ERROR_CHECK(touch_pad_fsm_start());
+
+        // 필터 초기값이 안정될 때까지 대기 후 임계값 설정
+        if(baselines == NULL){
+            vTaskDelay(pdMS_TO_TICKS(300));
+        }
+        for(uint8_t i = 0; i < padCount; ++i){
+            uint32_t baseline = 0;
+            if(baselines != NULL){
+                baseline = baselines[i];
+            }else{
+                touch_pad_filter_read_baseline(pads[i], &baseline);
+            }
+            margins[i] = marginOf(baseline);
+            ESP_ERROR_CHECK(touch_pad_set_thresh(pads[i], margins[i]));
+            LOG_INFO("[calibration] touch%d: %u, threshold: +%u", i + 1, baseline, margins[i]);
+        }
+        ESP_ERROR_CHECK(touch_pad_intr_enable(TOUCH_PAD_INTR_MASK_ACTIVE));
+
+        // 라이트 슬립 중에도 FSM이 측정을 계속하며 임계값을 넘으면 깨어남
+        esp_sleep_enable_touchpad_wakeup();
+        power::release(power::TOUCH);
+    }
+
+    uint32_t baseline(uint8_t index){
+        uint32_t value = 0;
+        touch_pad_filter_read_baseline(pads[index], &value);
+        return value;
+    }
+
+    // deep sleep 중에도 FSM이 측정하도록 RTC 주변장치 전원 유지
+    // S3는 sleep 채널(저전력 측정) 하나만 지정 가능해 첫 패드로 지정, 나머지 패드는 유지된 FSM 인터럽트로 깨움
+    void sleepWakeup(){
+        if(padCount == 0){
+            return;
+        }
+        touch_pad_sleep_channel_enable(pads[0], true);
+        touch_pad_sleep_set_threshold(pads[0], margins[0]);
+        esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+        esp_sleep_enable_touchpad_wakeup();
+    }
+
+    // 필터를 거치지 않은 최근 측정값(FSM이 계속 측정 중)
+    uint32_t raw(uint8_t index){
+        uint32_t value = 0;
+        touch_pad_read_raw_data(pads[index], &value);
+        return value;
+    }
+
+    // 터치가 감지될 때까지 대기, 감지된 패드 인덱스를 비트마스크로 반환
+    uint32_t wait(){
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, ULONG_MAX, &bits, portMAX_DELAY);
+        return bits;
+    }
+#else
+    static detector::Threshold detectors[TOUCH_MAX_PADS];
+
+    // baselines: deep sleep 전에 저장한 기준값, 있으면 보정 측정을 생략
+    void begin(const uint8_t* touchPins, uint8_t count, const uint32_t* baselines = NULL){
+        padCount = MIN(count, TOUCH_MAX_PADS);
+        if(baselines != NULL){
+            for(uint8_t i = 0; i < padCount; ++i){
+                pins[i] = touchPins[i];
+                detectors[i].margin = marginOf(baselines[i]);
+                detectors[i].threshold = baselines[i];
+            }
+            return;
+        }
+        power::acquire(power::TOUCH);
+
+        // 300ms 동안 측정 간격마다 평균
+        uint64_t sum[TOUCH_MAX_PADS] = {0};
+        uint64_t samples = 0;
+        int64_t time = hal::millis();
+        do{
+            ++samples;
+            for(uint8_t i = 0; i < padCount; ++i){
+                sum[i] += hal::touchRead(touchPins[i]);
+            }
+            hal::delay(TOUCH_POLL_INTERVAL);
+        }while(hal::millis() - time < 300);
+        for(uint8_t i = 0; i < padCount; ++i){
+            pins[i] = touchPins[i];
+            detectors[i].calibrate(sum[i] / samples);
+            detectors[i].margin = marginOf(detectors[i].baseline());
+            LOG_INFO("[calibration] touch%d: %u, threshold: +%u", i + 1, detectors[i].baseline(), detectors[i].margin);
+        }
+        power::release(power::TOUCH);
+    }
+
+    uint32_t baseline(uint8_t index){
+        return detectors[index].baseline();
+    }
+
+    uint32_t raw(uint8_t index){
+        return hal::touchRead(pins[index]);
+    }
+
+#ifdef ESP_PLATFORM
+    // 판정 기준과 같은 값을 넘으면 깨어남
+    void sleepWakeup(){
+        for(uint8_t i = 0; i < padCount; ++i){
+            touchSleepWakeUpEnable(pins[i], detectors[i].threshold + detectors[i].margin);
+        }
+    }
+#endif
+
+    uint32_t wait(){
+        for(;;){
+            uint32_t bits = 0;
+            for(uint8_t i = 0; i < padCount; ++i){
+                if(detectors[i].update(hal::touchRead(pins[i]))){
+                    touchTime[i] = hal::micros();
+                    bits |= 1 << i;
+                }
+            }
+            if(bits){
+                return bits;
+            }
+            hal::delay(TOUCH_POLL_INTERVAL);
+        }
+    }
+#endif
+
+    // 터치 감지 시점부터 현재까지의 지연 시간을 기록
+    void handled(uint8_t index){
+        stats::record(stats::TOUCH_TO_STATE, touchTime[index]);
+
+        const latency::Histogram& histogram = stats::histograms[stats::TOUCH_TO_STATE];
+        LOG_DEBUG("[Touch] latency p50: %uus, p99: %uus, count: %u", histogram.percentile(500), histogram.percentile(990), histogram.count.load());
+    }
+}
\ No newline at end of file
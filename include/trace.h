@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "protocol.h"
+
+// 터치 원시값 기록 형식(호스트에서 빌드 가능)
+// [magic "TTRC"][version][channel count][interval(u16, ms)][baseline(u32)]...
+// 이후 측정마다 [tick << 1 | has event(varint)][event bits(has event일 때)][channel delta(zigzag varint)]...
+// tick: 직전 측정 이후 지난 interval 수, delta: 같은 채널 직전 값과의 차이(첫 값은 baseline 기준)
+
+#define TRACE_MAGIC "TTRC"
+#define TRACE_VERSION 1
+#define TRACE_MAX_CHANNELS 4
+#define TRACE_RECORD_MAX (5 + 1 + 5 * TRACE_MAX_CHANNELS)
+
+namespace trace{
+    typedef struct{
+        uint8_t channelCount;
+        uint16_t interval; // ms
+        uint32_t baselines[TRACE_MAX_CHANNELS]; // 기록 시작 시 기기가 사용하던 기준값
+    } header_t;
+
+    typedef struct{
+        uint32_t tick; // 기록 시작부터 지난 interval 수
+        uint8_t events; // 기기가 실제로 터치로 판정한 채널 비트
+        uint32_t values[TRACE_MAX_CHANNELS];
+    } sample_t;
+
+    inline bool encodeHeader(protocol::Writer& writer, const header_t& header){
+        writer.bytes(TRACE_MAGIC, 4);
+        writer.u8(TRACE_VERSION);
+        writer.u8(header.channelCount);
+        writer.u16(header.interval);
+        for(uint8_t i = 0; i < header.channelCount; ++i){
+            writer.u32(header.baselines[i]);
+        }
+        return writer.ok();
+    }
+
+    // 직전 측정을 기억해 차이만 기록, writer에 TRACE_RECORD_MAX 이상 남아있어야 함
+    struct Encoder{
+        header_t header;
+        uint32_t lastTick = 0;
+        uint32_t lastValues[TRACE_MAX_CHANNELS];
+
+        Encoder(const header_t& header): header(header){
+            memcpy(lastValues, header.baselines, sizeof(lastValues));
+        }
+
+        bool encode(protocol::Writer& writer, const sample_t& sample){
+            writer.varint((sample.tick - lastTick) << 1 | (sample.events != 0));
+            if(sample.events != 0){
+                writer.u8(sample.events);
+            }
+            for(uint8_t i = 0; i < header.channelCount; ++i){
+                writer.varint(protocol::zigzag((int32_t) (sample.values[i] - lastValues[i])));
+                lastValues[i] = sample.values[i];
+            }
+            lastTick = sample.tick;
+            return writer.ok();
+        }
+    };
+
+    // 기록이 길어도 되도록 측정마다 Reader를 새로 만듦(Reader는 64KB까지)
+    struct Decoder{
+        const uint8_t* data;
+        uint32_t length;
+        uint32_t offset = 0;
+        header_t header;
+        sample_t last;
+
+        Decoder(const uint8_t* data, uint32_t length): data(data), length(length){}
+
+        protocol::Reader reader() const{
+            uint32_t remaining = length - offset;
+            return protocol::Reader(data + offset, remaining > UINT16_MAX ? UINT16_MAX : remaining);
+        }
+
+        bool begin(){
+            protocol::Reader reader = this->reader();
+            const uint8_t* magic = reader.take(4);
+            if(magic == NULL || memcmp(magic, TRACE_MAGIC, 4) != 0 || reader.u8() != TRACE_VERSION){
+                return false;
+            }
+            header.channelCount = reader.u8();
+            header.interval = reader.u16();
+            if(header.channelCount == 0 || header.channelCount > TRACE_MAX_CHANNELS){
+                return false;
+            }
+            for(uint8_t i = 0; i < header.channelCount; ++i){
+                header.baselines[i] = reader.u32();
+                last.values[i] = header.baselines[i];
+            }
+            last.tick = 0;
+            offset += reader.offset;
+            return !reader.error;
+        }
+
+        // 다음 측정, 끝이거나 잘린 기록이면 false
+        bool next(sample_t& sample){
+            if(offset >= length){
+                return false;
+            }
+            protocol::Reader reader = this->reader();
+            uint32_t head = reader.varint();
+            last.tick += head >> 1;
+            last.events = head & 1 ? reader.u8() : 0;
+            for(uint8_t i = 0; i < header.channelCount; ++i){
+                last.values[i] += protocol::unzigzag(reader.varint());
+            }
+            if(reader.error){
+                return false;
+            }
+            offset += reader.offset;
+            sample = last;
+            return true;
+        }
+    };
+}
\ No newline at end of file
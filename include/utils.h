@@ -2,10 +2,14 @@
 
 #include <time.h>
 #include <string>
+#include <sys/time.h>
+
+#include "hal.h"
+
+#ifdef ESP_PLATFORM
 #include <esp_sleep.h>
-#include <esp_timer.h>
-#include <esp_random.h>
 #include <driver/rtc_io.h>
+#endif
 
 using namespace std;
 
@@ -16,7 +20,7 @@ inline uint32_t random_int(uint32_t max){
     if(max == 0){
         return 0;
     }
-    uint32_t val = esp_random();
+    uint32_t val = hal::random();
     return val % max;
 }
 
@@ -47,6 +51,7 @@ inline void strReplace(string& origin, string replace, string str){
     origin.replace(index, replace.length(), str);
 }
 
+#ifdef ESP_PLATFORM
 inline void lightSleep(gpio_num_t pin, int level, uint64_t time = 0){
     rtc_gpio_pullup_en(pin);
     esp_sleep_enable_ext0_wakeup(pin, level);
@@ -63,4 +68,5 @@ inline void deepSleep(gpio_num_t pin, int level, uint64_t time = 0){
         esp_sleep_enable_timer_wakeup(time);
     }
     esp_deep_sleep_start();
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
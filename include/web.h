@@ -1,18 +1,27 @@
 #pragma once
 
-#include <string>
-#include <utility>
-#include <sstream>
+#include <atomic>
+#include <string.h>
 #include <esp_wifi.h>
+#include <esp_timer.h>
 #include <esp_http_server.h>
 
+#include "logger.h"
 #include "wifi.h"
 #include "utils.h"
+#include "form.h"
 #include "storage.h"
 
+#define WEB_SCAN_MAX 20
+#define WEB_SCAN_TTL 30000 // 스캔 결과 유효 시간(ms), 지나면 다음 페이지 요청 때 다시 스캔
+#define WEB_CHUNK_SIZE 512
+#define WEB_RECV_SIZE 128
+#define WEB_FORM_MAX_LENGTH 1024 // /save 본문 최대 길이
+
 using namespace std;
 
-const char* indexHtml =
+// 설정 페이지는 SSID 목록 앞뒤 조각을 그대로 청크로 전송
+const char* indexHead =
 R"rawliteral(
 <!DOCTYPE HTML>
 <html>
@@ -20,25 +29,7 @@ R"rawliteral(
     <meta charset="utf-8">
     <meta name="viewport" content="width=device-width, initial-scale=1.0, minimum-scale=1.0, maximum-scale=1.0, user-scalable=no">
     <title>Iot Device WiFi Settings</title>
-    <style>
-        tr > td > input{
-            padding: 0;
-            width: 100%;
-            line-height: 24px;
-            //font-size: 16px;
-            border: 1px solid black;
-        }
-        table{
-            width: 92%;
-            margin: auto;
-            border: 1px solid black;
-            border-collapse: collapse;
-        }
-        td{
-            padding: 10px;
-            border: 1px solid black;
-        }
-    </style>
+    <link rel="stylesheet" href="style.css">
 </head>
 <body>
     <h1><center>Iot Device WiFi Settings</center></h1>
@@ -46,7 +37,10 @@ R"rawliteral(
         <table>
             <tr>
                 <td width="24%">SSID</td>
-                <td>${ssid}</td>
+                <td>)rawliteral";
+
+const char* indexTail =
+R"rawliteral(</td>
             </tr>
             <tr>
                 <td>Password</td>
@@ -96,99 +90,222 @@ R"rawliteral(
 </html>
 )rawliteral";
 
+extern const uint8_t styleGzipStart[] asm("_binary_style_css_gz_start");
+extern const uint8_t styleGzipEnd[] asm("_binary_style_css_gz_end");
+
 namespace web{
+    typedef struct{
+        char ssid[33];
+        int8_t rssi;
+    } ap_t;
+
     httpd_handle_t server = NULL;
 
-    static string urlDecode(const string& encoded){
-        ostringstream decoded;
-        for(size_t i = 0; i < encoded.length(); ++i){
-            if(encoded[i] == '%'){
-                if(i + 2 < encoded.length()){
-                    int decoded_char;
-                    char hexStr[3] = {encoded[i + 1], encoded[i + 2], '\0'};
-                    istringstream(hexStr) >> hex >> decoded_char;
-                    decoded << static_cast<char>(decoded_char);
-                    i += 2;
-                }else{
-                    return "";
-                }
-            }else if(encoded[i] == '+'){
-                decoded << ' ';
-            }else{
-                decoded << encoded[i];
-            }
+    // 스캔 결과, 페이지는 기다리지 않고 캐시로 응답
+    // APSTA 모드에서 스캔하면 채널을 옮겨 다니느라 접속한 휴대폰의 연결이 끊길 수 있어 주기적으로 스캔하지 않음
+    // 서버 시작 시 한 번(아직 접속한 기기가 없음), 이후에는 페이지 요청 때 결과가 WEB_SCAN_TTL보다 오래됐을 때만 스캔
+    static ap_t scanCache[WEB_SCAN_MAX];
+    static uint8_t scanCount = 0;
+    static int64_t scanTime = -1; // ms, 마지막 스캔 완료 시각
+    static portMUX_TYPE scanLock = portMUX_INITIALIZER_UNLOCKED;
+    static atomic<bool> scanning = false;
+    static wifi_ap_record_t scanRecords[WEB_SCAN_MAX]; // 이벤트 태스크 스택이 작아 정적 변수로 둠
+
+    static void startScan(){
+        if(scanning.exchange(true)){
+            return;
+        }
+        esp_err_t err = esp_wifi_scan_start(NULL, false);
+        if(err != ESP_OK){
+            scanning = false;
+            LOG_WARN("[Web] Scan start failed: %s", esp_err_to_name(err));
         }
-        return decoded.str();
     }
-    
-    static pair<string, string> parseParameter(char* data){
-        string token;
-        istringstream iss(data);
-        pair<string, string> result("", "");
-        while(getline(iss, token, '&')){
-            size_t equalPos = token.find('=');
-            if(equalPos == string::npos){
+
+    static void scanDone(void* arg, esp_event_base_t base, int32_t id, void* data){
+        scanning = false;
+        uint16_t length = WEB_SCAN_MAX;
+        if(esp_wifi_scan_get_ap_records(&length, scanRecords) != ESP_OK){
+            return;
+        }
+
+        // 신호 세기 순으로 정렬되어 있으므로 같은 SSID는 처음 것만 사용
+        static ap_t result[WEB_SCAN_MAX];
+        uint8_t count = 0;
+        for(uint16_t i = 0; i < length; ++i){
+            const char* ssid = (const char*) scanRecords[i].ssid;
+            if(ssid[0] == '\0'){
                 continue;
             }
-            auto key = token.substr(0, equalPos);
-            if(key == "ssid"){
-                result.first = urlDecode(token.substr(equalPos + 1));
-            }else if(key == "password"){
-                result.second = urlDecode(token.substr(equalPos + 1));
+            bool duplicate = false;
+            for(uint8_t j = 0; j < count && !duplicate; ++j){
+                duplicate = strcmp(result[j].ssid, ssid) == 0;
+            }
+            if(!duplicate){
+                strlcpy(result[count].ssid, ssid, sizeof(result[count].ssid));
+                result[count].rssi = scanRecords[i].rssi;
+                ++count;
             }
         }
-        return result;
+
+        taskENTER_CRITICAL(&scanLock);
+        memcpy(scanCache, result, sizeof(ap_t) * count);
+        scanCount = count;
+        scanTime = millis();
+        taskEXIT_CRITICAL(&scanLock);
     }
 
-    static string getIndexPage(bool scan){
-        string index = indexHtml;
+    // 청크 전송용 버퍼, 가득 차면 전송
+    typedef struct{
+        httpd_req_t* req;
+        uint16_t length;
+        char data[WEB_CHUNK_SIZE];
+    } chunk_t;
 
-        uint16_t length = 0;
-        wifi_ap_record_t apInfo[32];
-        if(scan){
-            esp_wifi_scan_start(NULL, true);
-            esp_wifi_scan_get_ap_num(&length);
-            length = MIN(length, 32);
+    static esp_err_t flushChunk(chunk_t& chunk){
+        if(chunk.length == 0){
+            return ESP_OK;
+        }
+        esp_err_t err = httpd_resp_send_chunk(chunk.req, chunk.data, chunk.length);
+        chunk.length = 0;
+        return err;
+    }
 
-            esp_wifi_scan_get_ap_records(&length, apInfo);
-            esp_wifi_scan_stop();
+    static esp_err_t appendChunk(chunk_t& chunk, const char* data, size_t length){
+        while(length > 0){
+            if(chunk.length == sizeof(chunk.data) && flushChunk(chunk) != ESP_OK){
+                return ESP_FAIL;
+            }
+            size_t size = MIN(length, sizeof(chunk.data) - chunk.length);
+            memcpy(chunk.data + chunk.length, data, size);
+            chunk.length += size;
+            data += size;
+            length -= size;
         }
+        return ESP_OK;
+    }
 
-        if(length > 0){
-            string ssidInput = "<select name='ssid' style='width: 100%'>";
-            for(uint16_t i = 0; i < length; i++){
-                ssidInput += "<option>" + string((char*) apInfo[i].ssid) + "</option>";
+    // SSID에 포함된 HTML 특수문자 처리
+    static esp_err_t appendEscaped(chunk_t& chunk, const char* text){
+        for(; *text != '\0'; ++text){
+            const char* escaped = NULL;
+            switch(*text){
+                case '<': escaped = "&lt;"; break;
+                case '>': escaped = "&gt;"; break;
+                case '&': escaped = "&amp;"; break;
+                case '"': escaped = "&quot;"; break;
+                case '\'': escaped = "&#39;"; break;
+            }
+            esp_err_t err = escaped == NULL ? appendChunk(chunk, text, 1) : appendChunk(chunk, escaped, strlen(escaped));
+            if(err != ESP_OK){
+                return err;
             }
-            strReplace(index, "${ssid}", ssidInput + "</select>");
-        }else{
-            strReplace(index, "${ssid}", "<input type='text' required maxlength='100' name='ssid'>");
         }
-        return index;
+        return ESP_OK;
     }
 
     static esp_err_t indexPage(httpd_req_t* req){
-        return httpd_resp_send(req, getIndexPage(true).c_str(), HTTPD_RESP_USE_STRLEN);
+        int64_t start = esp_timer_get_time();
+        httpd_resp_set_type(req, "text/html");
+        if(httpd_resp_send_chunk(req, indexHead, HTTPD_RESP_USE_STRLEN) != ESP_OK){
+            return ESP_FAIL;
+        }
+        int64_t firstByte = esp_timer_get_time() - start;
+
+        ap_t list[WEB_SCAN_MAX];
+        taskENTER_CRITICAL(&scanLock);
+        uint8_t count = scanCount;
+        int64_t age = scanTime < 0 ? -1 : millis() - scanTime;
+        memcpy(list, scanCache, sizeof(ap_t) * count);
+        taskEXIT_CRITICAL(&scanLock);
+        if(age < 0 || age >= WEB_SCAN_TTL){
+            startScan(); // 새로고침하면 반영됨
+        }
+
+        static chunk_t chunk; // httpd 서버 태스크 하나에서만 사용
+        chunk.req = req;
+        chunk.length = 0;
+        esp_err_t err = ESP_OK;
+        if(count > 0){
+            const char* open = "<select name='ssid'>";
+            err = appendChunk(chunk, open, strlen(open));
+            for(uint8_t i = 0; i < count && err == ESP_OK; ++i){
+                err = appendChunk(chunk, "<option>", 8);
+                if(err == ESP_OK){
+                    err = appendEscaped(chunk, list[i].ssid);
+                }
+                if(err == ESP_OK){
+                    err = appendChunk(chunk, "</option>", 9);
+                }
+            }
+            if(err == ESP_OK){
+                err = appendChunk(chunk, "</select>", 9);
+            }
+        }else{
+            const char* input = "<input type='text' required maxlength='100' name='ssid'>";
+            err = appendChunk(chunk, input, strlen(input));
+        }
+        if(err == ESP_OK){
+            err = appendChunk(chunk, indexTail, strlen(indexTail));
+        }
+        if(err == ESP_OK){
+            err = flushChunk(chunk);
+        }
+        if(err != ESP_OK){
+            return ESP_FAIL;
+        }
+        httpd_resp_send_chunk(req, NULL, 0);
+        LOG_INFO("[Web] GET / ttfb: %lldus, total: %lldus, ap: %u, scan age: %lldms", firstByte, esp_timer_get_time() - start, count, age);
+        return ESP_OK;
     }
 
+    static esp_err_t stylePage(httpd_req_t* req){
+        httpd_resp_set_type(req, "text/css");
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        httpd_resp_set_hdr(req, "Cache-Control", "max-age=86400");
+        return httpd_resp_send(req, (const char*) styleGzipStart, styleGzipEnd - styleGzipStart);
+    }
+
+    // 본문을 WEB_RECV_SIZE씩 받아 바로 파싱, 필드 외의 내용은 저장하지 않음
     static esp_err_t savePage(httpd_req_t* req){
-        char content[req->content_len + 1] = {0};
-        int ret = httpd_req_recv(req, content, req->content_len);
-        if(ret > 0){
-            auto result = parseParameter(content);
-            if(result.first.length() > 0 && result.second.length() > 7){
-                httpd_resp_send(req, saveHtml, HTTPD_RESP_USE_STRLEN);
-                vTaskDelay(1500 / portTICK_PERIOD_MS);
-
-                wifi::setData(result.first, result.second);
-                esp_restart();
-            }else{
-                httpd_resp_send(req, saveHtmlError, HTTPD_RESP_USE_STRLEN);
+        if(req->content_len > WEB_FORM_MAX_LENGTH){
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+            return ESP_FAIL;
+        }
+
+        char ssid[33]; // SSID 최대 32바이트
+        char password[65]; // 비밀번호 최대 64바이트
+        form::field_t fields[] = {
+            {"ssid", ssid, sizeof(ssid)},
+            {"password", password, sizeof(password)},
+        };
+        form::Parser parser(fields, 2);
+
+        char buffer[WEB_RECV_SIZE];
+        size_t remaining = req->content_len;
+        bool valid = true;
+        while(remaining > 0){
+            int ret = httpd_req_recv(req, buffer, MIN(remaining, sizeof(buffer)));
+            if(ret <= 0){
+                if(ret == HTTPD_SOCK_ERR_TIMEOUT){
+                    httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, NULL);
+                }
+                return ESP_FAIL;
             }
+            valid &= parser.feed(buffer, ret);
+            remaining -= ret;
+        }
+        valid &= parser.finish();
+
+        if(valid && fields[0].length > 0 && fields[1].length > 7){
+            httpd_resp_send(req, saveHtml, HTTPD_RESP_USE_STRLEN);
+            vTaskDelay(1500 / portTICK_PERIOD_MS);
+
+            wifi::setData(ssid, password);
+            storage::flush();
+            esp_restart();
         }else{
-            if(ret == HTTPD_SOCK_ERR_TIMEOUT){
-                httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, NULL);
-            }
-            return ESP_FAIL;
+            httpd_resp_send(req, saveHtmlError, HTTPD_RESP_USE_STRLEN);
         }
         return ESP_OK;
     }
@@ -198,7 +315,7 @@ namespace web{
             return ESP_OK;
         }
 
-        std::cout << "[Web] Start Server\n";
+        LOG_INFO("[Web] Start Server");
         httpd_config_t config = HTTPD_DEFAULT_CONFIG();
         config.stack_size = 8192;
 
@@ -212,6 +329,14 @@ namespace web{
             };
             httpd_register_uri_handler(server, &index);
 
+            httpd_uri_t styleUri = {
+                .uri = "/style.css",
+                .method = HTTP_GET,
+                .handler = stylePage,
+                .user_ctx = NULL
+            };
+            httpd_register_uri_handler(server, &styleUri);
+
             httpd_uri_t saveUri = {
                 .uri = "/save",
                 .method = HTTP_POST,
@@ -219,6 +344,9 @@ namespace web{
                 .user_ctx = NULL
             };
             httpd_register_uri_handler(server, &saveUri);
+
+            esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, &scanDone, NULL);
+            startScan();
             return true;
         }
         return false;
@@ -229,7 +357,10 @@ namespace web{
             return false;
         }
 
-        std::cout << "[Web] Stop Server\n";
+        LOG_INFO("[Web] Stop Server");
+        esp_event_handler_unregister(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, &scanDone);
+        esp_wifi_scan_stop();
+        scanning = false;
         httpd_stop(server);
         server = NULL;
         return true;
@@ -5,12 +5,26 @@
 #include <esp_http_client.h>
 #include <esp_websocket_client.h>
 
+#include "logger.h"
 #include "servo.h"
 #include "utils.h"
 #include "storage.h"
+#include "ota.h"
+#include "backoff.h"
+#include "outbox.h"
 #include "battery.h"
+#include "stats.h"
+#include "profiler.h"
+#include "schedule.h"
+#include "reactor.h"
+#include "protocol.h"
 
 #define WEBSOCKET_URL "ws://localhost:8080/iot" // ws 주소 작성
+#define WEBSOCKET_BUFFER_SIZE 4096 // 프레임 하나의 최대 크기, OTA_DATA_V2는 이 크기 이하로 전송해야 함
+#define WEBSOCKET_RECONNECT_BASE 1000 // ms, 재연결 대기 시간은 실패할 때마다 두 배(지터 포함)
+#define WEBSOCKET_RECONNECT_CAP 60000
+#define WEBSOCKET_WELCOME_BASE 500 // ms, 환영 메시지 재전송 간격
+#define WEBSOCKET_WELCOME_CAP 8000
 
 typedef enum{
     CONTINUITY,
@@ -24,68 +38,249 @@ typedef enum{
 namespace ws{
     atomic<bool> connectServer = false;
     esp_websocket_client_handle_t webSocket = NULL;
+    atomic<uint32_t> connectCount = 0;
 
-    void sendWelcome(bool upState, bool downState){
-        auto device = storage::getDeviceId();
-        uint8_t buffer[device.length() + 3] = {
-            0x01, // protocol type (0x01: welcome, 0x02: door state, 0x03: switch state)
-            0x02, // [data] device type((0x01: checker, 0x02: switch bot)
-            (uint8_t) ((upState << 6) | (downState << 4) | (battery::level & 0b1111)) // [data] switch state, battery level
+    // 웹소켓 태스크에서만 사용, 서버 인증이 끝나면 초기화
+    static backoff::Backoff reconnectBackoff(WEBSOCKET_RECONNECT_BASE, WEBSOCKET_RECONNECT_CAP);
+
+    // 서버가 발급한 세션 재개 토큰, 끊긴 뒤 ttl 동안 환영 메시지 대신 사용
+    static portMUX_TYPE sessionLock = portMUX_INITIALIZER_UNLOCKED;
+    static uint8_t sessionToken[PROTOCOL_TOKEN_SIZE];
+    static uint16_t sessionTtl = 0; // s, 0이면 토큰 없음
+    static int64_t sessionExpire = -1; // ms, 연결 중에는 -1
+
+    // states: 채널별 상태 비트(switches::bits)
+    void sendWelcome(uint16_t states){
+        const char* device = storage::getDeviceId();
+        protocol::welcome_t welcome = {
+            .version = outbox::version,
+            .sequence = outbox::sequence++,
+            .channelCount = SWITCH_CHANNELS,
+            .states = states,
+            .battery = battery::level,
+            .deviceId = device,
+            .deviceIdLength = (uint8_t) strlen(device),
         };
-        for(uint8_t i = 0; i < device.length(); ++i){
-            buffer[3 + i] = device[i];
+        uint8_t buffer[OUTBOX_FRAME_SIZE];
+        protocol::Writer writer(buffer, sizeof(buffer));
+        if(protocol::encodeWelcome(writer, welcome) && outbox::push(buffer, writer.length)){
+            LOG_INFO("[Socket] 환영 메시지를 전송했습니다.");
+        }
+    }
+
+    // 유효한 토큰이 있으면 복사
+    static bool getSession(uint8_t* token){
+        portENTER_CRITICAL(&sessionLock);
+        bool valid = sessionTtl > 0 && (sessionExpire < 0 || hal::millis() < sessionExpire);
+        if(valid){
+            memcpy(token, sessionToken, PROTOCOL_TOKEN_SIZE);
         }
-        esp_websocket_client_send_with_opcode(webSocket, WS_TRANSPORT_OPCODES_BINARY, buffer, device.length() + 3, portMAX_DELAY);
-        cout << "[Socket] 환영 메시지를 전송했습니다.\n";
+        portEXIT_CRITICAL(&sessionLock);
+        return valid;
+    }
+
+    static void clearSession(){
+        portENTER_CRITICAL(&sessionLock);
+        sessionTtl = 0;
+        portEXIT_CRITICAL(&sessionLock);
+    }
+
+    // deep sleep 전에 호출, 토큰이 유효하면 남은 시간(s) 반환, 없으면 0
+    uint32_t exportSession(uint8_t* token, uint16_t& ttl){
+        portENTER_CRITICAL(&sessionLock);
+        int64_t remaining = sessionTtl == 0 ? 0 : sessionExpire < 0 ? sessionTtl * 1000LL : sessionExpire - hal::millis();
+        memcpy(token, sessionToken, PROTOCOL_TOKEN_SIZE);
+        ttl = sessionTtl;
+        portEXIT_CRITICAL(&sessionLock);
+        return remaining > 0 ? remaining / 1000 : 0;
     }
 
-    void sendSwitchState(ledc_channel_t channel, bool state){
-        uint8_t buffer[2] = {
-            0x03, // protocol type (0x01: welcome 0x02: door state, 0x03: switch state)
-            (uint8_t) ((channel << 6) | (state << 4) | (battery::level & 0b1111))
+    // deep sleep에서 깨어난 뒤 연결 전에 호출, remaining(s) 뒤 만료
+    void importSession(const uint8_t* token, uint16_t ttl, uint32_t remaining){
+        portENTER_CRITICAL(&sessionLock);
+        memcpy(sessionToken, token, PROTOCOL_TOKEN_SIZE);
+        sessionTtl = ttl;
+        sessionExpire = hal::millis() + remaining * 1000LL;
+        portEXIT_CRITICAL(&sessionLock);
+    }
+
+    // 연결 직후 첫 시도는 토큰이 있으면 세션 재개 요청, 이후 재전송은 환영 메시지
+    void greet(uint16_t states, bool first){
+        uint8_t token[PROTOCOL_TOKEN_SIZE];
+        if(!first || !getSession(token)){
+            sendWelcome(states);
+            return;
+        }
+
+        protocol::resume_t resume = {
+            .sequence = outbox::sequence++,
+            .channelCount = SWITCH_CHANNELS,
+            .states = states,
+            .battery = battery::level,
+        };
+        memcpy(resume.token, token, sizeof(token));
+        uint8_t buffer[OUTBOX_FRAME_SIZE];
+        protocol::Writer writer(buffer, sizeof(buffer));
+        if(protocol::encodeResume(writer, resume) && outbox::push(buffer, writer.length)){
+            LOG_INFO("[Socket] 세션 재개를 요청했습니다.");
+        }
+    }
+
+    // 명령을 실제로 반영한 시각(esp_timer, us)을 전달, v2 전용
+    void sendAck(uint16_t sequence, protocol::ack_status_t status, uint64_t time){
+        protocol::ack_t ack = {
+            .sequence = sequence,
+            .status = (uint8_t) status,
+            .time = time,
         };
-        esp_websocket_client_send_with_opcode(webSocket, WS_TRANSPORT_OPCODES_BINARY, buffer, 2, portMAX_DELAY);
+        uint8_t buffer[16];
+        protocol::Writer writer(buffer, sizeof(buffer));
+        protocol::encodeAck(writer, ack);
+        outbox::push(buffer, writer.length);
+    }
+
+    // 구간별 지연 시간 요약을 응답, 요청에 STATS_RESET이 있으면 이후 초기화
+    void sendStats(uint16_t sequence, uint8_t flags){
+        uint8_t buffer[OUTBOX_FRAME_SIZE];
+        protocol::Writer writer(buffer, sizeof(buffer));
+        if(stats::encode(writer, sequence)){
+            outbox::push(buffer, writer.length);
+        }
+        if(flags & protocol::STATS_RESET){
+            stats::reset();
+        }
+    }
+
+    // 마지막 태스크별 측정 결과를 응답, 태스크 수에 따라 여러 프레임
+    void sendProfile(uint16_t sequence){
+        for(uint8_t part = 0; ; ++part){
+            uint8_t buffer[OUTBOX_FRAME_SIZE];
+            protocol::Writer writer(buffer, sizeof(buffer));
+            if(!profiler::encode(writer, sequence, part)){
+                break;
+            }
+            outbox::push(buffer, writer.length);
+        }
+    }
+
+    // 저장된 일정과 기기의 현재 시각을 응답
+    void sendSchedule(uint16_t sequence){
+        uint8_t buffer[OUTBOX_FRAME_SIZE];
+        protocol::Writer writer(buffer, sizeof(buffer));
+        if(schedule::encode(writer, sequence)){
+            outbox::push(buffer, writer.length);
+        }
+    }
+
+    // 전송 태스크가 보내며 같은 채널의 상태는 마지막 값만 전송됨
+    void sendSwitchState(ledc_channel_t channel){
+        outbox::pushState(channel);
     }
 
     bool isConnected(){
         return esp_websocket_client_is_connected(webSocket);
     }
 
+    static void onServerConnected(){
+        connectServer = true;
+        outbox::ready = true;
+        reconnectBackoff.reset();
+        stats::record(stats::SERVER_CONNECT, stats::wifiTime);
+        reactor::post(reactor::SERVER_CONNECTED);
+    }
+
+    // 세션 발급, 재개 응답 처리, 다른 프레임이면 false
+    static bool handleSession(const uint8_t* frame, uint16_t length){
+        if(length == 0){
+            return false;
+        }
+        if(frame[0] == protocol::SESSION_V2){
+            protocol::session_t session;
+            if(protocol::decodeSession(frame, length, session)){
+                portENTER_CRITICAL(&sessionLock);
+                memcpy(sessionToken, session.token, sizeof(sessionToken));
+                sessionTtl = session.ttl;
+                sessionExpire = -1;
+                portEXIT_CRITICAL(&sessionLock);
+            }
+            return true;
+        }
+        if(frame[0] == protocol::RESUME_ACK_V2){
+            protocol::resume_ack_t ack;
+            if(connectServer || !protocol::decodeResumeAck(frame, length, ack)){
+                return true;
+            }
+            if(ack.status == protocol::RESUME_OK){
+                outbox::version = 2;
+                onServerConnected();
+                LOG_INFO("[Socket] 세션을 재개했습니다.");
+            }else{
+                clearSession();
+                reactor::post(reactor::RESUME_REJECTED);
+                LOG_WARN("[Socket] 세션 재개 거부, 환영 메시지를 전송합니다.");
+            }
+            return true;
+        }
+        return false;
+    }
+
     static void eventHandler(void* object, esp_event_base_t base, int32_t eventId, void* eventData){
         esp_websocket_event_data_t* data = (esp_websocket_event_data_t*) eventData;
-        if(eventId == WEBSOCKET_EVENT_DISCONNECTED){
+        if(eventId == WEBSOCKET_EVENT_CONNECTED){
+            ++connectCount;
+            reactor::post(reactor::SOCKET_CONNECTED);
+        }else if(eventId == WEBSOCKET_EVENT_DISCONNECTED){
             if(connectServer){
-                cout << "[Socket] 연결이 끊어졌습니다.\n";
+                LOG_WARN("[Socket] 연결이 끊어졌습니다.");
             }
             connectServer = false;
+            outbox::ready = false; // 이후 상태 변경은 다음 연결까지 남겨 둠
+            ota::abort(); // 수신 핸들러와 같은 태스크에서 취소
+            outbox::version = PROTOCOL_VERSION; // 새 연결에서 서버가 다시 알려줌
+            outbox::versioned = false;
+
+            portENTER_CRITICAL(&sessionLock);
+            if(sessionExpire < 0){
+                sessionExpire = hal::millis() + sessionTtl * 1000LL;
+            }
+            portEXIT_CRITICAL(&sessionLock);
+
+            // WiFi가 없는 동안의 실패는 서버 부하가 아니므로 대기 시간을 늘리지 않음
+            if(!wifi::connect){
+                reconnectBackoff.reset();
+            }
+            esp_websocket_client_set_reconnect_timeout(webSocket, reconnectBackoff.next());
+            reactor::post(reactor::SOCKET_DISCONNECTED);
         }else if(eventId == WEBSOCKET_EVENT_ERROR){
             if(!wifi::connect){
                 return;
             }
 
-            cout << "[Socket] esp_tls_stack_err: " << data->error_handle.esp_tls_stack_err << ", status: " << data->error_handle.esp_ws_handshake_status_code << ", socket: " << data->error_handle.esp_transport_sock_errno << "\n";
+            LOG_WARN("[Socket] esp_tls_stack_err: %d, status: %d, socket: %d", data->error_handle.esp_tls_stack_err, data->error_handle.esp_ws_handshake_status_code, data->error_handle.esp_transport_sock_errno);
             switch(data->error_handle.error_type){
                 case WEBSOCKET_ERROR_TYPE_NONE:
-                    cout << "[Socket] 에러 발생, type: NONE\n";
+                    LOG_WARN("[Socket] 에러 발생, type: NONE");
                     break;
                 case WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT:
-                    cout << "[Socket] 에러 발생, type: TCP_TRANSPORT\n";
+                    LOG_WARN("[Socket] 에러 발생, type: TCP_TRANSPORT");
                     break;
                 case WEBSOCKET_ERROR_TYPE_PONG_TIMEOUT:
-                    cout << "[Socket] 에러 발생, type: PONG_TIMEOUT\n";
+                    LOG_WARN("[Socket] 에러 발생, type: PONG_TIMEOUT");
                     break;
                 case WEBSOCKET_ERROR_TYPE_HANDSHAKE:
-                    cout << "[Socket] 에러 발생, type: TYPE_HANDSHAKE\n";
+                    LOG_WARN("[Socket] 에러 발생, type: TYPE_HANDSHAKE");
                     break;
             }
         }else if(eventId == WEBSOCKET_EVENT_DATA){
-            if(data->op_code == STRING && !connectServer){
+            if(data->op_code == BINARY && data->payload_offset == 0 && data->data_len == data->payload_len){
+                handleSession((const uint8_t*) data->data_ptr, data->data_len);
+            }else if(data->op_code == STRING && !connectServer){
                 string device(data->data_ptr, data->data_len);
                 if(storage::getDeviceId() == device){
-                    connectServer = true;
-                    std::cout << "[Socket] 서버와 연결되었습니다.\n";
+                    onServerConnected();
+                    LOG_INFO("[Socket] 서버와 연결되었습니다.");
                 }else{
-                    std::cout << "[Socket] 서버 연결 실패. 기기명 불일치 [device: " << storage::getDeviceId() << ", receive: " << device << ", len: " << data->data_len << "]\n";
+                    LOG_WARN("[Socket] 서버 연결 실패. 기기명 불일치 [device: %s, receive: %s, len: %d]", storage::getDeviceId(), logger::Text(data->data_ptr, data->data_len), data->data_len);
                 }
             }
         }
@@ -94,19 +289,26 @@ namespace ws{
     void start(esp_event_handler_t handler){
         esp_websocket_client_config_t socketConfig = {
             .uri = WEBSOCKET_URL,
+            .buffer_size = WEBSOCKET_BUFFER_SIZE,
             .keep_alive_enable = true,
-            .reconnect_timeout_ms = 1000,
+            .reconnect_timeout_ms = (int) reconnectBackoff.next(),
         };
 
-        while(webSocket == NULL){
-            webSocket = esp_websocket_client_init(&socketConfig);
+        // 메모리 부족 등으로 실패하면 다른 태스크가 돌 수 있도록 대기 후 재시도
+        backoff::Backoff retry(WEBSOCKET_RECONNECT_BASE, WEBSOCKET_RECONNECT_CAP);
+        while((webSocket = esp_websocket_client_init(&socketConfig)) == NULL){
+            LOG_ERROR("[Socket] 클라이언트 생성 실패");
+            vTaskDelay(pdMS_TO_TICKS(retry.next()));
         }
         esp_websocket_register_events(webSocket, WEBSOCKET_EVENT_ANY, handler, NULL);
         esp_websocket_register_events(webSocket, WEBSOCKET_EVENT_ANY, eventHandler, NULL);
+        outbox::start(webSocket);
 
-        esp_err_t err = ESP_FAIL;
-        while(err != ESP_OK){
-            err = esp_websocket_client_start(webSocket);
+        retry.reset();
+        esp_err_t err;
+        while((err = esp_websocket_client_start(webSocket)) != ESP_OK){
+            LOG_ERROR("[Socket] 클라이언트 시작 실패: %s", esp_err_to_name(err));
+            vTaskDelay(pdMS_TO_TICKS(retry.next()));
         }
     }
 }
\ No newline at end of file
@@ -3,38 +3,105 @@
 #include <nvs.h>
 #include <atomic>
 #include <string.h>
+#include <inttypes.h>
 #include <esp_wifi.h>
 #include <nvs_flash.h>
 #include <esp32-hal.h>
 
+#include "logger.h"
 #include "utils.h"
+#include "power.h"
+#include "config.h"
+#include "stats.h"
+#include "reactor.h"
+#include "storage.h"
 
 using namespace std;
 
 namespace wifi{
     atomic<bool> connect = false;
 
+    // 마지막으로 연결에 성공한 AP 정보, 스캔 없이 바로 연결할 때 사용
+    // DHCP 임대 정보는 LWIP_DHCP_RESTORE_LAST_IP 설정으로 lwip가 NVS에 저장
+    typedef storage::ap_cache_t ap_cache_t;
+
+    static bool fastPath = false;
+    atomic<uint32_t> fastConnectCount = 0;
+    atomic<uint32_t> slowConnectCount = 0;
+
+    // 저장된 BSSID/채널이 있으면 해당 AP로 바로 연결, 없으면 전체 스캔
+    static void setConnectTarget(bool fast){
+        wifi_config_t config;
+        if(esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK){
+            return;
+        }
+
+        ap_cache_t cache;
+        fastPath = fast && storage::getApCache(&cache);
+        if(fastPath){
+            memcpy(config.sta.bssid, cache.bssid, sizeof(cache.bssid));
+            config.sta.bssid_set = true;
+            config.sta.channel = cache.channel;
+            config.sta.scan_method = WIFI_FAST_SCAN;
+        }else{
+            config.sta.bssid_set = false;
+            config.sta.channel = 0;
+            config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        }
+        esp_wifi_set_config(WIFI_IF_STA, &config);
+    }
+
+    static void saveConnectTarget(){
+        wifi_ap_record_t info;
+        if(esp_wifi_sta_get_ap_info(&info) != ESP_OK){
+            return;
+        }
+
+        ap_cache_t cache;
+        memcpy(cache.bssid, info.bssid, sizeof(cache.bssid));
+        cache.channel = info.primary;
+        storage::setApCache(cache);
+    }
+
     static void eventHandler(void* arg, esp_event_base_t base, int32_t id, void* data){
         static int64_t start = -1;
         if(id == IP_EVENT_STA_GOT_IP){
             connect = true;
-            printf("[WiFi] 아이피: " IPSTR ", time: %lldms\n", IP2STR(&((ip_event_got_ip_t*) data)->ip_info.ip), millis() - start);
+            stats::record(stats::WIFI_CONNECT, stats::wifiTime);
+            stats::wifiTime = esp_timer_get_time();
+            reactor::post(reactor::WIFI_CONNECTED);
+            uint32_t count = fastPath ? ++fastConnectCount : ++slowConnectCount;
+            char ip[16];
+            esp_ip4addr_ntoa(&((ip_event_got_ip_t*) data)->ip_info.ip, ip, sizeof(ip));
+            LOG_INFO("[WiFi] 아이피: %s, time: %lldms, path: %s(%" PRIu32 ")", logger::Text(ip), millis() - start, fastPath ? "fast" : "slow", count);
+            saveConnectTarget();
         }else{
             switch(id){
                 case WIFI_EVENT_STA_START:
-                    printf("[WiFi] Start WiFi\n");
+                    LOG_INFO("[WiFi] Start WiFi");
                     start = millis();
+                    stats::wifiTime = esp_timer_get_time();
+                    setConnectTarget(true);
                     esp_wifi_connect();
                     break;
                 case WIFI_EVENT_STA_DISCONNECTED:
                     if(connect){
-                        printf("[WiFi] Disconnected WiFi\n");
+                        // 연결되어 있던 AP(GOT_IP에서 저장)로 바로 재연결, 이전에 전체 스캔으로 연결했어도 다시 fast path 사용
+                        LOG_INFO("[WiFi] Disconnected WiFi");
+                        start = millis();
+                        stats::wifiTime = esp_timer_get_time();
+                        setConnectTarget(true);
+                    }else if(fastPath){
+                        // 저장된 AP로 연결 실패시 전체 스캔으로 재시도
+                        LOG_WARN("[WiFi] Fast connect failed, reason: %d", ((wifi_event_sta_disconnected_t*) data)->reason);
+                        setConnectTarget(false);
                     }
                     connect = false;
+                    reactor::post(reactor::WIFI_DISCONNECTED);
                     esp_wifi_connect();
                     break;
                 case WIFI_EVENT_AP_START:
-                    printf("[WiFi] Start AP\n");
+                    LOG_INFO("[WiFi] Start AP");
                     break;
             }
         }
@@ -44,13 +111,35 @@ namespace wifi{
         ESP_ERROR_CHECK(esp_netif_init());
         ESP_ERROR_CHECK(esp_event_loop_create_default());
 
-        esp_netif_create_default_wifi_sta();
+        esp_netif_t* netif = esp_netif_create_default_wifi_sta();
+#ifdef WIFI_STATIC_IP
+        // DHCP를 멈추고 주소를 지정하면 연결 시 IP_EVENT_STA_GOT_IP가 바로 발생
+        esp_netif_ip_info_t ip = {};
+        ip.ip.addr = esp_ip4addr_aton(WIFI_STATIC_IP);
+        ip.gw.addr = esp_ip4addr_aton(WIFI_STATIC_GATEWAY);
+        ip.netmask.addr = esp_ip4addr_aton(WIFI_STATIC_NETMASK);
+        if(ip.ip.addr == UINT32_MAX || ip.gw.addr == UINT32_MAX || ip.netmask.addr == UINT32_MAX){ // 변환 실패(IPADDR_NONE)
+            LOG_ERROR("[WiFi] 고정 IP 설정이 잘못되어 DHCP를 사용합니다.");
+        }else{
+            esp_netif_dhcpc_stop(netif);
+            ESP_ERROR_CHECK(esp_netif_set_ip_info(netif, &ip));
+
+            esp_netif_dns_info_t dns = {};
+            dns.ip.type = ESP_IPADDR_TYPE_V4;
+            dns.ip.u_addr.ip4.addr = esp_ip4addr_aton(WIFI_STATIC_DNS);
+            esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+            LOG_INFO("[WiFi] 고정 IP: %s", WIFI_STATIC_IP);
+        }
+#else
+        (void) netif;
+#endif
         ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &eventHandler, NULL));
         ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &eventHandler, NULL));
 
         wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
         ESP_ERROR_CHECK(esp_wifi_init(&cfg));
         ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+        power::wifiSleep();
         ESP_ERROR_CHECK(esp_wifi_start());
     }
 
@@ -69,16 +158,18 @@ namespace wifi{
         ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &config));
     }
 
-    void setData(string ssid, string password){
+    // ssid는 최대 32바이트, password는 최대 64바이트까지 사용
+    void setData(const char* ssid, const char* password){
         wifi_config_t config = {
             .sta = {
                 .ssid = "",
                 .password = ""
             }
         };
-        strcpy((char*) config.sta.ssid, ssid.c_str());
-        strcpy((char*) config.sta.password, password.c_str());
+        strncpy((char*) config.sta.ssid, ssid, sizeof(config.sta.ssid));
+        strncpy((char*) config.sta.password, password, sizeof(config.sta.password));
         esp_wifi_set_config(WIFI_IF_STA, &config);
+        storage::clearApCache();
     }
     
     void clear(){
@@ -89,6 +180,7 @@ namespace wifi{
             }
         };
         esp_wifi_set_config(WIFI_IF_STA, &staConfig);
+        storage::clearApCache();
     }
 
     wifi_mode_t getMode(){
@@ -0,0 +1,247 @@
+#include <chrono>
+#include <thread>
+#include <string>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal.h"
+#include "ring.h"
+#include "form.h"
+#include "legacy_form.h"
+#include "filter.h"
+#include "logger.h"
+#include "latency.h"
+#include "protocol.h"
+#include "switches.h"
+
+// 호스트 마이크로벤치마크, 결과는 연산 1회당 시간(ns)
+// ./build-native/bench [필터]
+
+using namespace std;
+
+static const char* only = NULL;
+static volatile uint64_t sink = 0; // 최적화로 연산이 사라지는 것을 막음
+
+template<typename F>
+static void run(const char* name, uint32_t iterations, F body){
+    if(only != NULL && strstr(name, only) == NULL){
+        return;
+    }
+    for(uint32_t i = 0; i < iterations / 10; ++i){
+        body(i);
+    }
+
+    auto start = chrono::steady_clock::now();
+    for(uint32_t i = 0; i < iterations; ++i){
+        body(i);
+    }
+    double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    printf("%-32s %10.1f ns/op  (%u iterations)\n", name, elapsed / iterations, iterations);
+}
+
+static void protocolBench(){
+    uint8_t buffer[64];
+    uint8_t entries[4] = {
+        protocol::entry(0, true),
+        protocol::entry(1, false),
+        protocol::entry(2, true),
+        protocol::entry(3, false),
+    };
+
+    run("protocol/v1 command decode", 10000000, [&](uint32_t i){
+        uint8_t frame = protocol::entry(i & 1, i & 2);
+        protocol::command_t command;
+        protocol::decodeCommand(&frame, 1, command);
+        sink += protocol::entryAt(command, 0);
+    });
+    run("protocol/v2 command roundtrip", 10000000, [&](uint32_t i){
+        protocol::command_t command = {
+            .version = 2,
+            .sequence = (uint16_t) i,
+            .count = 4,
+            .entries = entries,
+        };
+        protocol::Writer writer(buffer, sizeof(buffer));
+        protocol::encodeCommand(writer, command);
+
+        protocol::command_t decoded;
+        protocol::decodeCommand(buffer, writer.length, decoded);
+        sink += decoded.sequence + protocol::entryAt(decoded, 3);
+    });
+    run("protocol/v1 welcome encode", 10000000, [&](uint32_t i){
+        protocol::welcome_t welcome = {
+            .version = 1,
+            .channelCount = 2,
+            .states = (uint16_t) (i & 3),
+            .battery = 10,
+            .deviceId = "abcde_1234",
+            .deviceIdLength = 10,
+        };
+        protocol::Writer writer(buffer, sizeof(buffer));
+        protocol::encodeWelcome(writer, welcome);
+        sink += writer.length;
+    });
+    run("protocol/telemetry delta roundtrip", 10000000, [&](uint32_t i){
+        protocol::telemetry_t telemetry = {
+            .sequence = (uint16_t) i,
+            .mask = (1 << protocol::TELEMETRY_RSSI) | (1 << protocol::TELEMETRY_HEAP_FREE),
+        };
+        telemetry.values[protocol::TELEMETRY_RSSI] = (int32_t) (i & 7) - 4;
+        telemetry.values[protocol::TELEMETRY_HEAP_FREE] = -4096;
+        protocol::Writer writer(buffer, sizeof(buffer));
+        protocol::encodeTelemetry(writer, telemetry);
+
+        protocol::telemetry_t decoded;
+        protocol::decodeTelemetry(buffer, writer.length, decoded);
+        sink += writer.length + decoded.values[protocol::TELEMETRY_RSSI];
+    });
+}
+
+static void latencyBench(){
+    static latency::Histogram histogram;
+    run("latency/record", 20000000, [&](uint32_t i){
+        histogram.record(hal::random() & 0xFFFFF);
+    });
+    run("latency/p99", 1000000, [&](uint32_t i){
+        sink += histogram.percentile(990);
+    });
+}
+
+static void ringBench(){
+    static Ring<uint64_t, 64> ring;
+    run("ring/push+pop", 20000000, [&](uint32_t i){
+        ring.push(i);
+        sink += *ring.front();
+        ring.pop();
+    });
+}
+
+static void filterBench(){
+    static const filter::curve_point_t curve[] = {
+        {3300, 0}, {3600, 1}, {3680, 2}, {3740, 3}, {3770, 4}, {3800, 5},
+        {3850, 6}, {3920, 7}, {3980, 8}, {4060, 9}, {4150, 10},
+    };
+    uint16_t samples[64];
+    filter::Ema<2> average;
+    run("filter/64-sample burst", 1000000, [&](uint32_t i){
+        for(uint8_t j = 0; j < 64; ++j){
+            samples[j] = 1900 + (hal::random() & 0x3F);
+        }
+        uint16_t mVolt = average.update(filter::median(samples, 64) * 2038 / 1000);
+        sink += filter::levelOf(curve, sizeof(curve) / sizeof(curve[0]), mVolt);
+    });
+}
+
+static void formBench(){
+    string body = "ssid=My+Home+WiFi%20%EA%B0%80&password=p%40ssw0rd%21%21";
+    run("form/legacy parseParameter", 1000000, [&](uint32_t i){
+        auto result = legacy::parseParameter((char*) body.c_str());
+        sink += result.first.length() + result.second.length();
+    });
+
+    char ssid[33];
+    char password[65];
+    form::field_t fields[] = {
+        {"ssid", ssid, sizeof(ssid)},
+        {"password", password, sizeof(password)},
+    };
+    run("form/parser", 1000000, [&](uint32_t i){
+        form::Parser parser(fields, 2);
+        parser.feed(body.data(), body.length());
+        sink += parser.finish() + fields[0].length + fields[1].length;
+    });
+    run("form/parser 8-byte chunks", 1000000, [&](uint32_t i){
+        form::Parser parser(fields, 2);
+        for(size_t offset = 0; offset < body.length(); offset += 8){
+            parser.feed(body.data() + offset, min(body.length() - offset, (size_t) 8));
+        }
+        sink += parser.finish() + fields[0].length + fields[1].length;
+    });
+}
+
+// 시뮬레이션 시간으로 터치 연속 입력 방지 동작을 확인(10ms 간격 터치 1000회)
+static void switchBench(){
+    if(only == NULL || strstr("switches/touch flood", only) != NULL){
+        hal::setMicros(0);
+        uint32_t accepted = 0;
+        for(uint32_t i = 0; i < 1000; ++i){
+            hal::advance(10 * 1000);
+            bool state;
+            accepted += switches::toggle(0, 500, protocol::ORIGIN_TOUCH, state);
+        }
+        printf("%-32s %10u toggles in %lldms (lockout 500ms)\n", "switches/touch flood", accepted, (long long) hal::millis());
+    }
+
+    run("switches/set+canToggle", 20000000, [&](uint32_t i){
+        hal::advance(1000);
+        if(switches::canToggle(1, 500)){
+            sink += switches::set(1, i & 1);
+        }
+    });
+    run("switches/setIf", 20000000, [&](uint32_t i){
+        sink += switches::setIf(1, i & 1, protocol::ORIGIN_SERVER, switches::load(1).version);
+    });
+
+    // 터치(반전)와 서버 명령(설정)이 같은 채널을 동시에 바꿈, 상태는 바뀔 때마다 뒤집히므로 버전과 상태가 맞아야 함
+    if(only == NULL || strstr("switches/touch vs server race", only) != NULL){
+        const uint32_t iterations = 1000000;
+        switches::words[1] = 0;
+        atomic<uint32_t> changes(0);
+        thread touch([&](){
+            for(uint32_t i = 0; i < iterations; ++i){
+                bool state;
+                changes += switches::toggle(1, 0, protocol::ORIGIN_TOUCH, state);
+            }
+        });
+        for(uint32_t i = 0; i < iterations; ++i){
+            changes += switches::set(1, (i >> 3) & 1, protocol::ORIGIN_SERVER);
+        }
+        touch.join();
+        switches::snapshot_t snapshot = switches::load(1);
+        bool consistent = snapshot.version == changes && snapshot.state == (changes & 1);
+        printf("%-32s %10u changes, version %u, %s\n", "switches/touch vs server race", changes.load(), snapshot.version, consistent ? "consistent" : "MISMATCH");
+    }
+}
+
+// 호출한 태스크가 부담하는 비용(write)과 출력 태스크의 변환 비용(format), 기존 방식(cout, printf) 비교
+static void logBench(){
+    char line[LOG_LINE_SIZE];
+    run("log/write", 10000000, [&](uint32_t i){
+        logger::write(LOG_LEVEL_INFO, "[Servo] %d번 스위치 %s", i & 3, i & 1 ? "켜짐" : "꺼짐");
+        logger::queue.pop();
+    });
+    run("log/write text", 10000000, [&](uint32_t i){
+        logger::write(LOG_LEVEL_INFO, "[LAN] mDNS: %s.local", logger::Text("switchbot-1234"));
+        logger::queue.pop();
+    });
+    logger::write(LOG_LEVEL_INFO, "[Servo] %d번 스위치 %s", 1, "켜짐");
+    logger::record_t record = *logger::queue.front();
+    logger::queue.pop();
+    run("log/format", 2000000, [&](uint32_t i){
+        sink += logger::format(record, line, sizeof(line));
+    });
+    run("log/snprintf", 2000000, [&](uint32_t i){
+        sink += snprintf(line, sizeof(line), "[Servo] %d번 스위치 %s\n", (int) (i & 3), i & 1 ? "켜짐" : "꺼짐");
+    });
+    ostringstream stream;
+    run("log/ostream", 2000000, [&](uint32_t i){
+        stream.str("");
+        stream << "[Servo] " << (i & 3) << "번 스위치 " << (i & 1 ? "켜짐" : "꺼짐") << "\n";
+        sink += stream.tellp();
+    });
+}
+
+int main(int argc, char** argv){
+    if(argc > 1){
+        only = argv[1];
+    }
+    protocolBench();
+    latencyBench();
+    ringBench();
+    filterBench();
+    formBench();
+    switchBench();
+    logBench();
+    return 0;
+}
\ No newline at end of file
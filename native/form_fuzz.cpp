@@ -0,0 +1,108 @@
+#include <regex>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal.h"
+#include "form.h"
+#include "legacy_form.h"
+
+// form::Parser와 이전 구현(legacy_form.h)의 결과 비교, 입력을 임의로 나눠서 feed
+// ./build-native/form_fuzz [반복 횟수]
+
+using namespace std;
+
+#define SSID_SIZE 33
+#define PASSWORD_SIZE 65
+
+static const char* keys[] = {"ssid", "password", "ssid", "password", "foo", "ss", "", "passwordx"};
+static const char* pieces[] = {
+    "a", "Z", "0", "+", "=", "%20", "%41", "%eA", "%7e", "%00", "%", "%4", "%G1", "%zz", "%%", "%e2%9c%93", "abcdefgh",
+};
+
+static string randomBody(){
+    string body;
+    uint32_t fieldCount = hal::random() % 5;
+    for(uint32_t i = 0; i < fieldCount; ++i){
+        if(i > 0){
+            body += '&';
+        }
+        body += keys[hal::random() % (sizeof(keys) / sizeof(keys[0]))];
+        if(hal::random() % 8 != 0){
+            body += '=';
+        }
+        uint32_t pieceCount = hal::random() % 24;
+        for(uint32_t j = 0; j < pieceCount; ++j){
+            body += pieces[hal::random() % (sizeof(pieces) / sizeof(pieces[0]))];
+        }
+    }
+    return body;
+}
+
+// 등록한 필드의 모든 값이 올바른 %XX만 포함하고 버퍼에 들어가면 파서가 성공해야 함
+static bool expectValid(const string& body){
+    static const regex escaped("^([^%]|%[0-9a-fA-F]{2})*$");
+    size_t start = 0;
+    while(start <= body.length()){
+        size_t end = body.find('&', start);
+        if(end == string::npos){
+            end = body.length();
+        }
+        string token = body.substr(start, end - start);
+        size_t equal = token.find('=');
+        if(equal != string::npos){
+            string key = token.substr(0, equal);
+            string value = token.substr(equal + 1);
+            if(key == "ssid" || key == "password"){
+                size_t capacity = key == "ssid" ? SSID_SIZE : PASSWORD_SIZE;
+                if(!regex_match(value, escaped) || value.find("%00") != string::npos || legacy::urlDecode(value).length() >= capacity){
+                    return false;
+                }
+            }
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+int main(int argc, char** argv){
+    uint32_t iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    uint32_t accepted = 0;
+    for(uint32_t i = 0; i < iterations; ++i){
+        string body = randomBody();
+
+        char ssid[SSID_SIZE];
+        char password[PASSWORD_SIZE];
+        form::field_t fields[] = {
+            {"ssid", ssid, sizeof(ssid)},
+            {"password", password, sizeof(password)},
+        };
+        form::Parser parser(fields, 2);
+        bool ok = true;
+        for(size_t offset = 0; offset < body.length();){
+            size_t size = 1 + hal::random() % 7;
+            size = size < body.length() - offset ? size : body.length() - offset;
+            ok &= parser.feed(body.data() + offset, size);
+            offset += size;
+        }
+        ok &= parser.finish();
+
+        bool valid = expectValid(body);
+        if(ok != valid){
+            printf("mismatch(ok: %d, expected: %d): %s\n", ok, valid, body.c_str());
+            return 1;
+        }
+        if(!ok){
+            continue;
+        }
+        ++accepted;
+
+        auto expected = legacy::parseParameter((char*) body.c_str());
+        if(expected.first != ssid || expected.second != password || fields[0].length != strlen(ssid) || fields[1].length != strlen(password)){
+            printf("value mismatch: %s\n  legacy: [%s] [%s]\n  parser: [%s] [%s]\n", body.c_str(), expected.first.c_str(), expected.second.c_str(), ssid, password);
+            return 1;
+        }
+    }
+    printf("form_fuzz: %u inputs, %u accepted, no mismatch\n", iterations, accepted);
+    return 0;
+}
\ No newline at end of file
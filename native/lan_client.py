@@ -0,0 +1,101 @@
+# LAN 직접 제어 클라이언트(include/lan.h), 표준 라이브러리만 사용
+# python lan_client.py <기기 주소> <공유 키> <채널>=<0|1> [<채널>=<0|1> ...] [--repeat N]
+# 예: python lan_client.py switchbot-1234.local change-me 0=1 1=0 --repeat 20
+
+import argparse
+import hashlib
+import hmac
+import os
+import socket
+import statistics
+import struct
+import time
+
+PORT = 40000
+MAC_SIZE = 16
+
+HELLO = 0xA0
+HELLO_ACK = 0xA1
+REQUEST = 0xA2
+RESPONSE = 0xA3
+
+COMMAND_V2 = 0x84
+ACK_V2 = 0x85
+
+
+def sign(key, data):
+    return hmac.new(key, data, hashlib.sha256).digest()[:MAC_SIZE]
+
+
+def verified(key, frame):
+    return len(frame) > MAC_SIZE and hmac.compare_digest(sign(key, frame[:-MAC_SIZE]), frame[-MAC_SIZE:])
+
+
+class Client:
+    def __init__(self, host, key, timeout=1.0):
+        self.address = (socket.gethostbyname(host), PORT)
+        self.key = key
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(timeout)
+        self.session = None
+        self.counter = 0
+        self.sequence = 0
+
+    def hello(self):
+        nonce = struct.unpack('<I', os.urandom(4))[0]
+        self.sock.sendto(struct.pack('<BI', HELLO, nonce), self.address)
+        frame, _ = self.sock.recvfrom(128)
+        if len(frame) != 13 + MAC_SIZE or frame[0] != HELLO_ACK or not verified(self.key, frame):
+            raise RuntimeError('잘못된 HELLO 응답(키 불일치?)')
+        received, self.session, self.counter = struct.unpack('<III', frame[1:13])
+        if received != nonce:
+            raise RuntimeError('nonce 불일치')
+        return self.session
+
+    # entries: [(채널, 상태)], 반환: (상태, 기기 수락 시각(us, 서보 이동 전), 왕복 시간(ms))
+    def command(self, entries):
+        if self.session is None:
+            self.hello()
+        self.counter += 1
+        self.sequence = (self.sequence + 1) & 0xFFFF
+        payload = struct.pack('<BHB', COMMAND_V2, self.sequence, len(entries))
+        payload += bytes((channel << 4) | (1 if state else 0) for channel, state in entries)
+        frame = struct.pack('<BII', REQUEST, self.session, self.counter) + payload
+        frame += sign(self.key, frame)
+
+        start = time.perf_counter()
+        self.sock.sendto(frame, self.address)
+        response, _ = self.sock.recvfrom(128)
+        elapsed = (time.perf_counter() - start) * 1000
+        if response[0] != RESPONSE or not verified(self.key, response):
+            raise RuntimeError('잘못된 응답')
+        session, counter, kind, sequence, status, accepted = struct.unpack('<IIBHBQ', response[1:-MAC_SIZE])
+        if session != self.session or counter != self.counter or kind != ACK_V2 or sequence != self.sequence:
+            raise RuntimeError('응답이 요청과 맞지 않음')
+        return status, accepted, elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('host')
+    parser.add_argument('key')
+    parser.add_argument('entries', nargs='+', help='채널=상태, 예: 0=1')
+    parser.add_argument('--repeat', type=int, default=1, help='상태를 번갈아 보내며 왕복 시간 측정')
+    args = parser.parse_args()
+
+    entries = [tuple(int(value) for value in entry.split('=')) for entry in args.entries]
+    client = Client(args.host, args.key.encode())
+    print('session: %08x' % client.hello())
+
+    times = []
+    for i in range(args.repeat):
+        current = [(channel, state ^ (i & 1)) for channel, state in entries]
+        status, accepted, elapsed = client.command(current)
+        times.append(elapsed)
+        print('status: %d, accepted: %dus, rtt: %.2fms' % (status, accepted, elapsed))
+    if len(times) > 1:
+        print('rtt p50: %.2fms, max: %.2fms' % (statistics.median(times), max(times)))
+
+
+if __name__ == '__main__':
+    main()
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <sstream>
+
+// 스트리밍 파서(form.h) 이전의 구현, 벤치마크와 비교 퍼징에서만 사용
+
+using namespace std;
+
+namespace legacy{
+    inline string urlDecode(const string& encoded){
+        ostringstream decoded;
+        for(size_t i = 0; i < encoded.length(); ++i){
+            if(encoded[i] == '%'){
+                if(i + 2 < encoded.length()){
+                    int decoded_char;
+                    char hexStr[3] = {encoded[i + 1], encoded[i + 2], '\0'};
+                    istringstream(hexStr) >> hex >> decoded_char;
+                    decoded << static_cast<char>(decoded_char);
+                    i += 2;
+                }else{
+                    return "";
+                }
+            }else if(encoded[i] == '+'){
+                decoded << ' ';
+            }else{
+                decoded << encoded[i];
+            }
+        }
+        return decoded.str();
+    }
+
+    inline pair<string, string> parseParameter(char* data){
+        string token;
+        istringstream iss(data);
+        pair<string, string> result("", "");
+        while(getline(iss, token, '&')){
+            size_t equalPos = token.find('=');
+            if(equalPos == string::npos){
+                continue;
+            }
+            auto key = token.substr(0, equalPos);
+            if(key == "ssid"){
+                result.first = urlDecode(token.substr(equalPos + 1));
+            }else if(key == "password"){
+                result.second = urlDecode(token.substr(equalPos + 1));
+            }
+        }
+        return result;
+    }
+}
\ No newline at end of file
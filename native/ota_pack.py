@@ -0,0 +1,56 @@
+# 펌웨어 이미지를 OTA 전송용으로 압축하고 웹소켓 프레임으로 나눔(include/ota.h)
+# OTA_KEY=<공유 키> python ota_pack.py <firmware.bin> [출력 파일(.zz)]
+# 서버는 OTA_BEGIN_V2 -> OTA_DATA_V2... -> OTA_END_V2 순서로 보내고 OTA_STATUS_V2로 진행 상황을 받음
+# OTA_BEGIN_V2 서명에는 그 기기에 발급한 현재 세션 토큰(SESSION_V2)이 들어가므로 서버가 전송 직전에 frames(token=...)로 만듦
+# 이미지 버전(esp_app_desc_t)이 기기에서 실행 중인 버전보다 높지 않으면 OTA_END_V2에 OTA_DOWNGRADE로 거부됨
+
+import hashlib
+import hmac
+import os
+import struct
+import sys
+import zlib
+
+OTA_BEGIN_V2 = 0x88
+OTA_DATA_V2 = 0x89
+OTA_END_V2 = 0x8A
+
+FRAME_SIZE = 4096 # WEBSOCKET_BUFFER_SIZE
+DATA_SIZE = FRAME_SIZE - 7
+MAC_SIZE = 16 # PROTOCOL_OTA_MAC_SIZE
+TOKEN_SIZE = 16 # PROTOCOL_TOKEN_SIZE
+
+
+def pack(image):
+    return zlib.compress(image, 9)
+
+
+# sequence는 프레임마다 증가, OTA_STATUS_V2 응답과 짝을 맞출 때 사용
+# key: 기기의 OTA_KEY(없으면 LAN_KEY), token: 기기의 현재 세션 토큰(16바이트), OTA_BEGIN_V2 서명에 사용
+def frames(image, compressed, key, token=bytes(TOKEN_SIZE), sequence=0):
+    begin = struct.pack('<BHII', OTA_BEGIN_V2, sequence, len(image), len(compressed)) + hashlib.sha256(image).digest()
+    yield begin + hmac.new(key, begin + token, hashlib.sha256).digest()[:MAC_SIZE]
+    for offset in range(0, len(compressed), DATA_SIZE):
+        sequence = (sequence + 1) & 0xFFFF
+        yield struct.pack('<BHI', OTA_DATA_V2, sequence, offset) + compressed[offset:offset + DATA_SIZE]
+    yield struct.pack('<BH', OTA_END_V2, (sequence + 1) & 0xFFFF)
+
+
+def main():
+    with open(sys.argv[1], 'rb') as source:
+        image = source.read()
+    compressed = pack(image)
+    output = sys.argv[2] if len(sys.argv) > 2 else sys.argv[1] + '.zz'
+    with open(output, 'wb') as target:
+        target.write(compressed)
+
+    key = os.environ.get('OTA_KEY', '').encode()
+    if not key:
+        print('OTA_KEY가 없으면 기기가 OTA_UNAUTHORIZED로 거부합니다.')
+    count = sum(1 for _ in frames(image, compressed, key))
+    print('image: %d bytes, compressed: %d bytes (%.1f%%), frames: %d' % (len(image), len(compressed), len(compressed) * 100 / len(image), count))
+    print('sha256: %s' % hashlib.sha256(image).hexdigest())
+
+
+if __name__ == '__main__':
+    main()
\ No newline at end of file
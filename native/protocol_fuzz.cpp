@@ -0,0 +1,476 @@
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "protocol.h"
+
+// protocol.h의 모든 프레임 형식 확인
+// 1. 임의의 값으로 만든 프레임: encode -> decode -> encode 결과가 같아야 하고, 잘린 프레임은 거부해야 함
+// 2. 임의의 바이트열, 잘린 프레임: 모든 decode*에 넣어 범위 밖을 읽지 않아야 하고(ASan), 받아들인 값은 다시 encode -> decode해도 같아야 함
+// 입력은 정확한 크기로 할당하므로 끝을 넘어 읽으면 ASan이 잡음
+// ./build-native/protocol_fuzz [반복 횟수]
+
+using namespace std;
+
+#define FUZZ_MAX_LENGTH 300
+#define FUZZ_STATS_CAPACITY 16
+#define FUZZ_TASK_CAPACITY 24
+
+// 프레임 종류마다 decode 결과를 담는 곳, 포인터 필드는 입력 버퍼를 가리킴
+typedef struct{
+    protocol::welcome_t welcome;
+    protocol::switch_state_t state; // SWITCH_STATE, COMMAND
+    protocol::ack_t ack;
+    protocol::stats_request_t statsRequest;
+    uint16_t sequence;
+    uint16_t duration;
+    uint8_t count;
+    protocol::stage_stats_t stages[FUZZ_STATS_CAPACITY];
+    protocol::ota_begin_t otaBegin;
+    protocol::ota_data_t otaData; // OTA_DATA, CAPTURE_DATA
+    protocol::ota_report_t otaReport;
+    protocol::session_t session;
+    protocol::resume_t resume;
+    protocol::resume_ack_t resumeAck;
+    protocol::telemetry_t telemetry;
+    protocol::profile_t profile;
+    protocol::task_stats_t tasks[FUZZ_TASK_CAPACITY];
+    protocol::schedule_t schedule;
+    protocol::versioned_t versioned;
+} frame_t;
+
+typedef struct{
+    const char* name;
+    bool (*decode)(const uint8_t* data, uint16_t length, frame_t& frame);
+    bool (*encode)(protocol::Writer& writer, const frame_t& frame);
+    void (*generate)(frame_t& frame); // encode할 수 있는 임의의 값
+    bool tail; // 마지막 필드가 나머지 전체라서 잘린 프레임도 받아들일 수 있음
+    uint16_t legacy; // 이 길이로 잘린 프레임은 v1 형식으로 읽힘(COMMAND: 1바이트), 없으면 0
+} codec_t;
+
+static uint8_t scratch[FUZZ_MAX_LENGTH]; // 생성한 값의 포인터 필드가 가리키는 곳
+
+static uint8_t r8(){
+    return hal::random();
+}
+
+static uint16_t r16(){
+    return hal::random();
+}
+
+static uint32_t r32(){
+    return hal::random();
+}
+
+static uint8_t* randomBytes(uint16_t length){
+    for(uint16_t i = 0; i < length; ++i){
+        scratch[i] = r8();
+    }
+    return scratch;
+}
+
+static void fillBytes(uint8_t* data, uint16_t length){
+    memcpy(data, randomBytes(length), length);
+}
+
+static void generateSchedule(frame_t& frame){
+    frame.schedule.sequence = r16();
+    frame.schedule.flags = r8();
+    frame.schedule.time = r32();
+    frame.schedule.count = r8() % (PROTOCOL_MAX_SCHEDULES + 1);
+    for(uint8_t i = 0; i < frame.schedule.count; ++i){
+        frame.schedule.entries[i] = {r8(), r8(), r16(), r8(), r8()};
+    }
+}
+
+static void generateVersioned(frame_t& frame){
+    frame.versioned.sequence = r16();
+    frame.versioned.battery = r8();
+    frame.versioned.count = r8() % (PROTOCOL_MAX_CHANNELS + 1);
+    for(uint8_t i = 0; i < frame.versioned.count; ++i){
+        // 버전은 varint 길이가 모두 나오도록 자릿수를 섞음
+        frame.versioned.entries[i] = {r8(), r8(), r32() >> (r8() % 32)};
+    }
+}
+
+static const codec_t codecs[] = {
+    {"WELCOME",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeWelcome(data, length, frame.welcome); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeWelcome(writer, frame.welcome); },
+        [](frame_t& frame){
+            frame.welcome.version = 1;
+            frame.welcome.sequence = 0;
+            frame.welcome.channelCount = 2;
+            frame.welcome.states = r8() & 0b11;
+            frame.welcome.battery = r8() & 0b1111;
+            frame.welcome.deviceIdLength = r8() % 32;
+            frame.welcome.deviceId = (const char*) randomBytes(frame.welcome.deviceIdLength);
+        }, true, 0},
+    {"WELCOME_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeWelcome(data, length, frame.welcome); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeWelcome(writer, frame.welcome); },
+        [](frame_t& frame){
+            frame.welcome.version = 2;
+            frame.welcome.sequence = r16();
+            frame.welcome.channelCount = r8() % (PROTOCOL_MAX_CHANNELS + 1);
+            frame.welcome.states = r16();
+            frame.welcome.battery = r8();
+            frame.welcome.deviceIdLength = r8();
+            frame.welcome.deviceId = (const char*) randomBytes(frame.welcome.deviceIdLength);
+        }, false, 0},
+    {"SWITCH_STATE",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeSwitchState(data, length, frame.state); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeSwitchState(writer, frame.state); },
+        [](frame_t& frame){
+            frame.state.version = 1;
+            frame.state.sequence = 0;
+            frame.state.battery = r8() & 0b1111;
+            frame.state.count = 1;
+            frame.state.entries = NULL;
+            frame.state.single = protocol::entry(r8() & 0b11, r8() & 1);
+        }, false, 0},
+    {"SWITCH_STATE_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeSwitchState(data, length, frame.state); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeSwitchState(writer, frame.state); },
+        [](frame_t& frame){
+            frame.state.version = 2;
+            frame.state.sequence = r16();
+            frame.state.battery = r8();
+            frame.state.count = r8() % (PROTOCOL_MAX_CHANNELS + 1);
+            frame.state.entries = randomBytes(frame.state.count);
+        }, false, 0},
+    {"COMMAND",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeCommand(data, length, frame.state); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeCommand(writer, frame.state); },
+        [](frame_t& frame){
+            frame.state.version = 1;
+            frame.state.sequence = 0;
+            frame.state.battery = 0;
+            frame.state.count = 1;
+            frame.state.entries = randomBytes(1);
+        }, true, 0},
+    {"COMMAND_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeCommand(data, length, frame.state); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeCommand(writer, frame.state); },
+        [](frame_t& frame){
+            frame.state.version = 2;
+            frame.state.sequence = r16();
+            frame.state.battery = 0;
+            frame.state.count = 1 + r8() % PROTOCOL_MAX_CHANNELS;
+            frame.state.entries = randomBytes(frame.state.count);
+        }, false, 1},
+    {"ACK_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeAck(data, length, frame.ack); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeAck(writer, frame.ack); },
+        [](frame_t& frame){
+            frame.ack = {r16(), r8(), ((uint64_t) r32() << 32) | r32()};
+        }, false, 0},
+    {"STATS_REQUEST_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeStatsRequest(data, length, frame.statsRequest); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeStatsRequest(writer, frame.statsRequest); },
+        [](frame_t& frame){
+            frame.statsRequest = {r16(), r8()};
+        }, false, 0},
+    {"STATS_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeStats(data, length, frame.sequence, frame.stages, FUZZ_STATS_CAPACITY, frame.count); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeStats(writer, frame.sequence, frame.stages, frame.count); },
+        [](frame_t& frame){
+            frame.sequence = r16();
+            frame.count = r8() % (FUZZ_STATS_CAPACITY + 1);
+            for(uint8_t i = 0; i < frame.count; ++i){
+                frame.stages[i] = {r8(), r32(), r32(), r32(), r32(), r32()};
+            }
+        }, false, 0},
+    {"OTA_BEGIN_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeOtaBegin(data, length, frame.otaBegin); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeOtaBegin(writer, frame.otaBegin); },
+        [](frame_t& frame){
+            frame.otaBegin.sequence = r16();
+            frame.otaBegin.imageSize = r32();
+            frame.otaBegin.compressedSize = r32();
+            fillBytes(frame.otaBegin.sha256, sizeof(frame.otaBegin.sha256));
+            fillBytes(frame.otaBegin.mac, sizeof(frame.otaBegin.mac));
+        }, false, 0},
+    {"OTA_DATA_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeOtaData(data, length, frame.otaData); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeOtaData(writer, frame.otaData); },
+        [](frame_t& frame){
+            frame.otaData.sequence = r16();
+            frame.otaData.offset = r32();
+            frame.otaData.length = 1 + r16() % (FUZZ_MAX_LENGTH - 8);
+            frame.otaData.data = randomBytes(frame.otaData.length);
+        }, true, 0},
+    {"OTA_END_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeOtaEnd(data, length, frame.sequence); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeOtaEnd(writer, frame.sequence); },
+        [](frame_t& frame){
+            frame.sequence = r16();
+        }, false, 0},
+    {"OTA_STATUS_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeOtaStatus(data, length, frame.otaReport); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeOtaStatus(writer, frame.otaReport); },
+        [](frame_t& frame){
+            frame.otaReport = {r16(), r8(), r32()};
+        }, false, 0},
+    {"SESSION_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeSession(data, length, frame.session); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeSession(writer, frame.session); },
+        [](frame_t& frame){
+            frame.session.sequence = r16();
+            frame.session.ttl = r16();
+            fillBytes(frame.session.token, sizeof(frame.session.token));
+        }, false, 0},
+    {"RESUME_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeResume(data, length, frame.resume); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeResume(writer, frame.resume); },
+        [](frame_t& frame){
+            frame.resume.sequence = r16();
+            fillBytes(frame.resume.token, sizeof(frame.resume.token));
+            frame.resume.channelCount = r8();
+            frame.resume.states = r16();
+            frame.resume.battery = r8();
+        }, false, 0},
+    {"RESUME_ACK_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeResumeAck(data, length, frame.resumeAck); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeResumeAck(writer, frame.resumeAck); },
+        [](frame_t& frame){
+            frame.resumeAck = {r16(), r8()};
+        }, false, 0},
+    {"TELEMETRY_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeTelemetry(data, length, frame.telemetry); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeTelemetry(writer, frame.telemetry); },
+        [](frame_t& frame){
+            frame.telemetry.sequence = r16();
+            frame.telemetry.flags = r8();
+            frame.telemetry.mask = r32() & ((1u << protocol::TELEMETRY_FIELD_MAX) - 1);
+            for(uint8_t i = 0; i < protocol::TELEMETRY_FIELD_MAX; ++i){
+                frame.telemetry.values[i] = frame.telemetry.mask & (1 << i) ? (int32_t) (r32() >> (r8() % 32)) * (r8() & 1 ? -1 : 1) : 0;
+            }
+        }, false, 0},
+    {"PROFILE_REQUEST_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeProfileRequest(data, length, frame.sequence); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeProfileRequest(writer, frame.sequence); },
+        [](frame_t& frame){
+            frame.sequence = r16();
+        }, false, 0},
+    {"PROFILE_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeProfile(data, length, frame.profile, frame.tasks, FUZZ_TASK_CAPACITY, frame.count); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeProfile(writer, frame.profile, frame.tasks, frame.count); },
+        [](frame_t& frame){
+            frame.profile = {r16(), r8(), r8(), r32(), r32(), r32()};
+            frame.count = r8() % 8;
+            const uint8_t* names = randomBytes(FUZZ_MAX_LENGTH);
+            for(uint8_t i = 0; i < frame.count; ++i){
+                frame.tasks[i] = {(const char*) names + i * 16, (uint8_t) (r8() % 16), r8(), r16(), r16()};
+            }
+        }, false, 0},
+    {"CAPTURE_REQUEST_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeCaptureRequest(data, length, frame.sequence, frame.duration); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeCaptureRequest(writer, frame.sequence, frame.duration); },
+        [](frame_t& frame){
+            frame.sequence = r16();
+            frame.duration = r16();
+        }, false, 0},
+    {"CAPTURE_DATA_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){
+            protocol::capture_data_t chunk;
+            bool ok = protocol::decodeCaptureData(data, length, chunk);
+            frame.otaData = {chunk.sequence, chunk.offset, chunk.data, chunk.length};
+            return ok;
+        },
+        [](protocol::Writer& writer, const frame_t& frame){
+            protocol::capture_data_t chunk = {frame.otaData.sequence, frame.otaData.offset, frame.otaData.data, frame.otaData.length};
+            return protocol::encodeCaptureData(writer, chunk);
+        },
+        [](frame_t& frame){
+            frame.otaData.sequence = r16();
+            frame.otaData.offset = r32();
+            frame.otaData.length = r16() % (FUZZ_MAX_LENGTH - 8); // 빈 데이터는 기록 끝
+            frame.otaData.data = randomBytes(frame.otaData.length);
+        }, true, 0},
+    {"SCHEDULE_SET_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeScheduleSet(data, length, frame.schedule); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeScheduleSet(writer, frame.schedule); },
+        [](frame_t& frame){
+            generateSchedule(frame);
+            frame.schedule.flags = 0;
+            frame.schedule.time = 0;
+        }, false, 0},
+    {"SCHEDULE_GET_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeScheduleGet(data, length, frame.sequence); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeScheduleGet(writer, frame.sequence); },
+        [](frame_t& frame){
+            frame.sequence = r16();
+        }, false, 0},
+    {"SCHEDULE_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeSchedule(data, length, frame.schedule); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeSchedule(writer, frame.schedule); },
+        generateSchedule, false, 0},
+    {"COMMAND_VERSIONED_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeVersionedCommand(data, length, frame.versioned); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeVersionedCommand(writer, frame.versioned); },
+        [](frame_t& frame){
+            generateVersioned(frame);
+            frame.versioned.battery = 0;
+            for(uint8_t i = 0; i < frame.versioned.count; ++i){
+                frame.versioned.entries[i].origin = protocol::ORIGIN_SERVER;
+            }
+        }, false, 0},
+    {"SWITCH_VERSION_V2",
+        [](const uint8_t* data, uint16_t length, frame_t& frame){ return protocol::decodeSwitchVersion(data, length, frame.versioned); },
+        [](protocol::Writer& writer, const frame_t& frame){ return protocol::encodeSwitchVersion(writer, frame.versioned); },
+        generateVersioned, false, 0},
+};
+
+#define CODEC_COUNT (sizeof(codecs) / sizeof(codecs[0]))
+
+static void dump(const char* label, const uint8_t* data, uint16_t length){
+    printf("  %s(%u):", label, length);
+    for(uint16_t i = 0; i < length; ++i){
+        printf(" %02x", data[i]);
+    }
+    printf("\n");
+}
+
+// 정확한 크기로 복사해 decode, 끝을 넘어 읽으면 ASan이 잡음
+static bool decodeExact(const codec_t& codec, const uint8_t* data, uint16_t length, frame_t& frame, vector<uint8_t>& owner){
+    owner.assign(data, data + length);
+    owner.shrink_to_fit();
+    return codec.decode(length > 0 ? owner.data() : NULL, length, frame);
+}
+
+static bool encode(const codec_t& codec, const frame_t& frame, vector<uint8_t>& output){
+    uint8_t buffer[FUZZ_MAX_LENGTH * 2];
+    protocol::Writer writer(buffer, sizeof(buffer));
+    if(!codec.encode(writer, frame)){
+        return false;
+    }
+    output.assign(buffer, buffer + writer.length);
+    return true;
+}
+
+// 받아들인 값은 encode -> decode -> encode 결과가 같아야 함(입력이 정규 형식이 아니어도 됨)
+static bool stable(const codec_t& codec, const frame_t& frame){
+    vector<uint8_t> first, second, owner;
+    frame_t decoded;
+    if(!encode(codec, frame, first)){
+        printf("%s: 받아들인 값을 encode하지 못함\n", codec.name);
+        return false;
+    }
+    if(!decodeExact(codec, first.data(), first.size(), decoded, owner) || !encode(codec, decoded, second) || first != second){
+        printf("%s: encode -> decode -> encode 불일치\n", codec.name);
+        dump("first", first.data(), first.size());
+        dump("second", second.data(), second.size());
+        return false;
+    }
+    return true;
+}
+
+static bool roundTrip(const codec_t& codec, uint32_t& truncated){
+    frame_t frame;
+    codec.generate(frame);
+    vector<uint8_t> encoded, owner;
+    if(!encode(codec, frame, encoded)){
+        printf("%s: 생성한 값을 encode하지 못함\n", codec.name);
+        return false;
+    }
+
+    frame_t decoded;
+    vector<uint8_t> again;
+    if(!decodeExact(codec, encoded.data(), encoded.size(), decoded, owner) || !encode(codec, decoded, again) || again != encoded){
+        printf("%s: 왕복 불일치\n", codec.name);
+        dump("encoded", encoded.data(), encoded.size());
+        dump("again", again.data(), again.size());
+        return false;
+    }
+
+    // 잘린 프레임, 뒤에 바이트가 붙은 프레임
+    for(uint16_t length = 0; length < encoded.size(); ++length){
+        frame_t partial;
+        bool accepted = decodeExact(codec, encoded.data(), length, partial, owner);
+        if(accepted && !codec.tail && length != codec.legacy){
+            printf("%s: %u바이트로 잘린 프레임을 받아들임\n", codec.name, length);
+            dump("encoded", encoded.data(), encoded.size());
+            return false;
+        }
+        if(accepted && !stable(codec, partial)){
+            return false;
+        }
+        ++truncated;
+    }
+    encoded.push_back(r8());
+    frame_t extended;
+    if(decodeExact(codec, encoded.data(), encoded.size(), extended, owner) && !codec.tail){
+        printf("%s: 뒤에 바이트가 붙은 프레임을 받아들임\n", codec.name);
+        return false;
+    }
+    return true;
+}
+
+// 모든 decode*에 넣어 봄, 받아들인 값은 encode -> decode -> encode가 같아야 함
+static bool fuzz(const uint8_t* data, uint16_t length, uint32_t* accepted){
+    for(uint8_t c = 0; c < CODEC_COUNT; ++c){
+        frame_t frame;
+        vector<uint8_t> owner;
+        if(!decodeExact(codecs[c], data, length, frame, owner)){
+            continue;
+        }
+        ++accepted[c];
+        if(!stable(codecs[c], frame)){
+            dump("input", data, length);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv){
+    uint32_t iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    uint32_t truncated = 0;
+    uint32_t mutated = 0;
+    uint32_t accepted[CODEC_COUNT] = {0};
+
+    for(uint32_t i = 0; i < iterations; ++i){
+        for(const codec_t& codec : codecs){
+            if(!roundTrip(codec, truncated)){
+                return 1;
+            }
+        }
+
+        // 임의의 바이트열, 대부분 실제 프레임 종류로 시작하도록 첫 바이트를 고름
+        uint16_t length = r16() % FUZZ_MAX_LENGTH;
+        uint8_t data[FUZZ_MAX_LENGTH * 2];
+        fillBytes(data, length);
+        if(length > 0 && r8() % 4 != 0){
+            data[0] = r8() & 1 ? protocol::V2 + r8() % 0x1A : r8() % 4;
+        }
+        if(!fuzz(data, length, accepted)){
+            return 1;
+        }
+
+        // 올바른 프레임의 몇 바이트만 바꿈, 길이가 맞아 필드 검사까지 들어감
+        for(const codec_t& codec : codecs){
+            frame_t frame;
+            vector<uint8_t> encoded;
+            codec.generate(frame);
+            encode(codec, frame, encoded);
+            length = encoded.size();
+            memcpy(data, encoded.data(), length);
+            for(uint8_t n = 1 + r8() % 3; n > 0 && length > 1; --n){
+                data[1 + r16() % (length - 1)] = r8();
+            }
+            if(!fuzz(data, length, accepted)){
+                return 1;
+            }
+            ++mutated;
+        }
+    }
+
+    printf("protocol_fuzz: %u round trips, %u truncated, %u mutated, %u random inputs, no mismatch\n", iterations * (uint32_t) CODEC_COUNT, truncated, mutated, iterations);
+    for(uint8_t c = 0; c < CODEC_COUNT; ++c){
+        printf("  %-22s accepted: %u\n", codecs[c].name, accepted[c]);
+    }
+    return 0;
+}
\ No newline at end of file
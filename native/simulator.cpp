@@ -0,0 +1,686 @@
+#include <cmath>
+#include <queue>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "hal.h"
+#include "backoff.h"
+#include "latency.h"
+#include "protocol.h"
+
+// /iot 웹소켓 서버 부하 테스트용 가상 스위치봇, websocket.h와 같은 protocol.h로 프레임 생성
+// 한 스레드의 epoll 이벤트 루프에서 기기 수만 개를 동시에 유지
+// ./build-native/simulator ws://host:8080/iot --devices 20000 --touch 2 --drop 0.5 --storm 60
+
+using namespace std;
+
+#define SIM_RECONNECT_CAP 60000 // ms, websocket.h와 같은 값
+#define SIM_WELCOME_BASE 500
+#define SIM_WELCOME_CAP 8000
+#define SIM_READ_SIZE 4096
+
+typedef struct{
+    string host;
+    string port = "80";
+    string path = "/";
+    uint32_t devices = 1000;
+    double touchRate = 1; // 기기당 분당 터치 수
+    double dropRate = 0; // 기기당 분당 강제 연결 끊김 수
+    uint32_t duration = 60; // s
+    uint8_t version = PROTOCOL_VERSION;
+    uint32_t rampRate = 500; // 초당 최초 연결 수
+    uint32_t reconnectDelay = 1000; // ms, 기기의 WEBSOCKET_RECONNECT_BASE
+    bool backoff = true; // false면 이전 펌웨어처럼 고정 간격으로 재연결, 재전송
+    uint32_t pingInterval = 10000; // ms, 0이면 ping 없음
+    uint32_t stormAt = 0; // s, 지정한 시각에 모든 연결을 동시에 끊음
+    uint32_t reportInterval = 5; // s
+} options_t;
+
+typedef enum{
+    IDLE,
+    CONNECTING, // TCP 연결 중
+    UPGRADING, // HTTP 101 대기
+    RESUMING, // 세션 재개 응답 대기
+    WELCOMING, // 기기 ID 응답 대기
+    ONLINE,
+} device_state_t;
+
+typedef enum{
+    CONNECT,
+    WELCOME,
+    TOUCH,
+    PING,
+    DROP,
+} timer_kind_t;
+
+typedef struct{
+    int fd = -1;
+    device_state_t state = IDLE;
+    uint32_t generation = 0; // 연결이 끊길 때마다 증가, 이전 연결의 타이머 무시
+    char id[11];
+    uint16_t states = 0;
+    uint16_t sequence = 0;
+    bool reconnecting = false;
+    backoff::Backoff reconnect{1000, SIM_RECONNECT_CAP};
+    backoff::Backoff welcome{SIM_WELCOME_BASE, SIM_WELCOME_CAP};
+    uint8_t token[PROTOCOL_TOKEN_SIZE];
+    uint16_t ttl = 0; // s, 0이면 토큰 없음
+    int64_t expire = -1; // us, 연결 중에는 -1
+    int64_t connectTime = 0;
+    int64_t welcomeTime = 0;
+    int64_t pingTime = 0;
+    string input;
+    string output;
+} device_t;
+
+typedef struct{
+    int64_t time;
+    uint32_t device;
+    uint32_t generation;
+    timer_kind_t kind;
+} sim_timer_t;
+
+struct TimerLater{
+    bool operator()(const sim_timer_t& a, const sim_timer_t& b) const{
+        return a.time > b.time;
+    }
+};
+
+typedef struct{
+    uint64_t connects = 0;
+    uint64_t reconnects = 0;
+    uint64_t failures = 0;
+    uint64_t closed = 0; // 서버가 끊은 연결
+    uint64_t touches = 0;
+    uint64_t commands = 0;
+    uint64_t welcomes = 0;
+    uint64_t resumes = 0; // 세션 재개 요청
+    uint64_t resumed = 0;
+    uint64_t sent = 0; // bytes
+    uint64_t received = 0;
+} counters_t;
+
+static options_t options;
+static vector<device_t> devices;
+static priority_queue<sim_timer_t, vector<sim_timer_t>, TimerLater> timers;
+static counters_t counters;
+static latency::Histogram connectLatency; // TCP 연결 ~ HTTP 101
+static latency::Histogram handshakeLatency; // 첫 환영 메시지 ~ 기기 ID 응답
+static latency::Histogram pingLatency; // ping ~ pong
+static addrinfo* address = NULL;
+static int epoll = -1;
+static uint32_t online = 0;
+
+static int64_t now(){
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double uniform(){
+    return (hal::random() + 0.5) / 4294967296.0;
+}
+
+// 평균 rate(분당)인 포아송 과정의 다음 간격(us)
+static int64_t nextInterval(double rate){
+    return (int64_t) (-log(uniform()) * 60e6 / rate);
+}
+
+static void schedule(uint32_t index, timer_kind_t kind, int64_t delay){
+    timers.push({now() + delay, index, devices[index].generation, kind});
+}
+
+static int64_t reconnectDelay(device_t& device){
+    return (options.backoff ? device.reconnect.next() : options.reconnectDelay) * 1000LL;
+}
+
+static int64_t welcomeDelay(device_t& device){
+    return (options.backoff ? device.welcome.next() : SIM_WELCOME_BASE) * 1000LL;
+}
+
+static void send(device_t& device, uint8_t opcode, const uint8_t* data, size_t length){
+    // 클라이언트 프레임은 마스킹 필수(RFC 6455)
+    uint8_t header[14];
+    size_t size = 0;
+    header[size++] = 0x80 | opcode;
+    if(length < 126){
+        header[size++] = 0x80 | length;
+    }else{
+        header[size++] = 0x80 | 126;
+        header[size++] = length >> 8;
+        header[size++] = length;
+    }
+    uint32_t mask = hal::random();
+    memcpy(header + size, &mask, 4);
+    size += 4;
+
+    device.output.append((const char*) header, size);
+    const uint8_t* key = (const uint8_t*) &mask;
+    for(size_t i = 0; i < length; ++i){
+        device.output.push_back(data[i] ^ key[i & 3]);
+    }
+}
+
+static void flush(uint32_t index);
+static void disconnect(uint32_t index, bool reconnect);
+
+static void sendWelcome(uint32_t index){
+    device_t& device = devices[index];
+    protocol::welcome_t welcome = {
+        .version = options.version,
+        .sequence = device.sequence++,
+        .channelCount = 2,
+        .states = device.states,
+        .battery = (uint8_t) (hal::random() % 11),
+        .deviceId = device.id,
+        .deviceIdLength = 10,
+    };
+    uint8_t buffer[64];
+    protocol::Writer writer(buffer, sizeof(buffer));
+    protocol::encodeWelcome(writer, welcome);
+    send(device, 0x2, buffer, writer.length);
+    ++counters.welcomes;
+}
+
+static void sendState(uint32_t index, uint8_t channel){
+    device_t& device = devices[index];
+    uint8_t entry = protocol::entry(channel, (device.states >> channel) & 1);
+    protocol::switch_state_t state = {
+        .version = options.version,
+        .sequence = device.sequence++,
+        .battery = 10,
+        .count = 1,
+        .entries = &entry,
+    };
+    uint8_t buffer[16];
+    protocol::Writer writer(buffer, sizeof(buffer));
+    protocol::encodeSwitchState(writer, state);
+    send(device, 0x2, buffer, writer.length);
+}
+
+static void sendResume(uint32_t index){
+    device_t& device = devices[index];
+    protocol::resume_t resume = {
+        .sequence = device.sequence++,
+        .channelCount = 2,
+        .states = device.states,
+        .battery = 10,
+    };
+    memcpy(resume.token, device.token, sizeof(resume.token));
+    uint8_t buffer[32];
+    protocol::Writer writer(buffer, sizeof(buffer));
+    protocol::encodeResume(writer, resume);
+    send(device, 0x2, buffer, writer.length);
+    ++counters.resumes;
+}
+
+static void startConnect(uint32_t index){
+    device_t& device = devices[index];
+    int fd = socket(address->ai_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(fd < 0){
+        ++counters.failures;
+        schedule(index, CONNECT, reconnectDelay(device));
+        return;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if(connect(fd, address->ai_addr, address->ai_addrlen) < 0 && errno != EINPROGRESS){
+        close(fd);
+        ++counters.failures;
+        schedule(index, CONNECT, reconnectDelay(device));
+        return;
+    }
+
+    device.fd = fd;
+    device.state = CONNECTING;
+    device.connectTime = now();
+    device.input.clear();
+    device.output.clear();
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.u32 = index;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+}
+
+static void upgrade(uint32_t index){
+    device_t& device = devices[index];
+    char request[512];
+    int length = snprintf(request, sizeof(request),
+        "GET %s HTTP/1.1\r\n"
+        "Host: %s:%s\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "User-Agent: ESP32 Websocket Client\r\n\r\n",
+        options.path.c_str(), options.host.c_str(), options.port.c_str()
+    );
+    device.output.append(request, length);
+    device.state = UPGRADING;
+}
+
+static void setOnline(uint32_t index){
+    device_t& device = devices[index];
+    device.state = ONLINE;
+    device.reconnect.reset();
+    ++online;
+    handshakeLatency.record(now() - device.welcomeTime);
+    if(options.touchRate > 0){
+        schedule(index, TOUCH, nextInterval(options.touchRate));
+    }
+    if(options.dropRate > 0){
+        schedule(index, DROP, nextInterval(options.dropRate));
+    }
+    if(options.pingInterval > 0){
+        schedule(index, PING, options.pingInterval * 1000LL);
+    }
+}
+
+// 수신 버퍼에서 완성된 프레임을 처리
+static void parse(uint32_t index){
+    device_t& device = devices[index];
+    if(device.state == UPGRADING){
+        size_t end = device.input.find("\r\n\r\n");
+        if(end == string::npos){
+            return;
+        }
+        if(device.input.compare(0, 12, "HTTP/1.1 101") != 0){
+            disconnect(index, true);
+            ++counters.failures;
+            return;
+        }
+        device.input.erase(0, end + 4);
+        connectLatency.record(now() - device.connectTime);
+        device.welcomeTime = now();
+        device.welcome.reset();
+        if(options.version >= 2 && device.ttl > 0 && now() < device.expire){
+            // 웹소켓 태스크의 ws::greet와 같이 첫 시도만 세션 재개
+            device.state = RESUMING;
+            sendResume(index);
+        }else{
+            device.state = WELCOMING;
+            sendWelcome(index);
+        }
+        schedule(index, WELCOME, welcomeDelay(device));
+    }
+
+    size_t offset = 0;
+    const uint8_t* data = (const uint8_t*) device.input.data();
+    while(device.fd >= 0 && device.input.length() - offset >= 2){
+        uint8_t opcode = data[offset] & 0x0F;
+        uint64_t length = data[offset + 1] & 0x7F;
+        size_t header = 2;
+        if(length == 126){
+            header = 4;
+        }else if(length == 127){
+            header = 10;
+        }
+        if(device.input.length() - offset < header){
+            break;
+        }
+        if(header == 4){
+            length = (data[offset + 2] << 8) | data[offset + 3];
+        }else if(header == 10){
+            length = 0;
+            for(uint8_t i = 0; i < 8; ++i){
+                length = (length << 8) | data[offset + 2 + i];
+            }
+        }
+        if(device.input.length() - offset - header < length){
+            break;
+        }
+
+        const uint8_t* payload = data + offset + header;
+        offset += header + length;
+        if(opcode == 0x1 && (device.state == WELCOMING || device.state == RESUMING)){
+            // 서버가 기기 ID를 그대로 돌려주면 연결 완료(websocket.h와 같은 조건)
+            if(length == 10 && memcmp(payload, device.id, 10) == 0){
+                setOnline(index);
+            }
+        }else if(opcode == 0x2 && length > 0 && payload[0] == protocol::SESSION_V2){
+            protocol::session_t session;
+            if(protocol::decodeSession(payload, length, session)){
+                memcpy(device.token, session.token, sizeof(device.token));
+                device.ttl = session.ttl;
+                device.expire = -1;
+            }
+        }else if(opcode == 0x2 && length > 0 && payload[0] == protocol::RESUME_ACK_V2){
+            protocol::resume_ack_t ack;
+            if(device.state != RESUMING || !protocol::decodeResumeAck(payload, length, ack)){
+                continue;
+            }
+            if(ack.status == protocol::RESUME_OK){
+                ++counters.resumed;
+                setOnline(index);
+            }else{
+                device.ttl = 0;
+                device.state = WELCOMING;
+                sendWelcome(index);
+            }
+        }else if(opcode == 0x2){
+            protocol::command_t command;
+            if(!protocol::decodeCommand(payload, length, command)){
+                continue;
+            }
+            ++counters.commands;
+            for(uint8_t i = 0; i < command.count; ++i){
+                uint8_t entry = protocol::entryAt(command, i);
+                uint8_t channel = protocol::entryChannel(entry);
+                if(channel >= 2){
+                    continue;
+                }
+                bool state = protocol::entryState(entry);
+                if(((device.states >> channel) & 1) != state){
+                    device.states ^= 1 << channel;
+                    sendState(index, channel);
+                }
+            }
+            if(command.version >= 2){
+                protocol::ack_t ack = {
+                    .sequence = command.sequence,
+                    .status = protocol::ACK_OK,
+                    .time = (uint64_t) now(),
+                };
+                uint8_t buffer[16];
+                protocol::Writer writer(buffer, sizeof(buffer));
+                protocol::encodeAck(writer, ack);
+                send(device, 0x2, buffer, writer.length);
+            }
+        }else if(opcode == 0x9){
+            send(device, 0xA, payload, length);
+        }else if(opcode == 0xA && device.pingTime > 0){
+            pingLatency.record(now() - device.pingTime);
+            device.pingTime = 0;
+        }else if(opcode == 0x8){
+            ++counters.closed;
+            disconnect(index, true);
+            return;
+        }
+    }
+    device.input.erase(0, offset);
+}
+
+static void flush(uint32_t index){
+    device_t& device = devices[index];
+    while(device.fd >= 0 && !device.output.empty()){
+        ssize_t written = ::send(device.fd, device.output.data(), device.output.length(), MSG_NOSIGNAL);
+        if(written < 0){
+            if(errno != EAGAIN){
+                disconnect(index, true);
+            }
+            return;
+        }
+        counters.sent += written;
+        device.output.erase(0, written);
+    }
+}
+
+static void disconnect(uint32_t index, bool reconnect){
+    device_t& device = devices[index];
+    if(device.fd < 0){
+        return;
+    }
+    close(device.fd);
+    device.fd = -1;
+    if(device.state == ONLINE){
+        --online;
+    }
+    device.state = IDLE;
+    ++device.generation;
+    if(device.expire < 0){
+        device.expire = now() + device.ttl * 1000000LL;
+    }
+    device.pingTime = 0;
+    if(reconnect){
+        device.reconnecting = true;
+        schedule(index, CONNECT, reconnectDelay(device));
+    }
+}
+
+static void handleTimer(const sim_timer_t& timer){
+    device_t& device = devices[timer.device];
+    if(timer.generation != device.generation){
+        return;
+    }
+    switch(timer.kind){
+        case CONNECT:
+            if(device.fd < 0){
+                ++counters.connects;
+                counters.reconnects += device.reconnecting;
+                startConnect(timer.device);
+            }
+            break;
+        case WELCOME:
+            if(device.state == WELCOMING || device.state == RESUMING){
+                device.state = WELCOMING;
+                sendWelcome(timer.device);
+                schedule(timer.device, WELCOME, welcomeDelay(device));
+            }
+            break;
+        case TOUCH:
+            if(device.state == ONLINE){
+                uint8_t channel = hal::random() & 1;
+                device.states ^= 1 << channel;
+                sendState(timer.device, channel);
+                ++counters.touches;
+                schedule(timer.device, TOUCH, nextInterval(options.touchRate));
+            }
+            break;
+        case PING:
+            if(device.state == ONLINE){
+                device.pingTime = now();
+                send(device, 0x9, NULL, 0);
+                schedule(timer.device, PING, options.pingInterval * 1000LL);
+            }
+            break;
+        case DROP:
+            disconnect(timer.device, true);
+            break;
+    }
+    flush(timer.device);
+}
+
+static void report(const char* label, double elapsed, counters_t& last){
+    printf(
+        "[%s %6.1fs] online: %6u, connects: %6llu(+%llu reconnect), fail: %llu, closed: %llu, touch: %llu, cmd: %llu, tx/rx: %llu/%lluKB\n",
+        label, elapsed, online,
+        (unsigned long long) (counters.connects - last.connects), (unsigned long long) (counters.reconnects - last.reconnects),
+        (unsigned long long) (counters.failures - last.failures), (unsigned long long) (counters.closed - last.closed),
+        (unsigned long long) (counters.touches - last.touches), (unsigned long long) (counters.commands - last.commands),
+        (unsigned long long) ((counters.sent - last.sent) / 1024), (unsigned long long) ((counters.received - last.received) / 1024)
+    );
+    last = counters;
+}
+
+static void printHistogram(const char* name, const latency::Histogram& histogram){
+    printf("%-10s count: %8u, p50: %8.2fms, p90: %8.2fms, p99: %8.2fms, max: %8.2fms\n",
+        name, histogram.count.load(),
+        histogram.percentile(500) / 1000.0, histogram.percentile(900) / 1000.0,
+        histogram.percentile(990) / 1000.0, histogram.max.load() / 1000.0
+    );
+}
+
+static bool parseUrl(const char* url){
+    string value = url;
+    if(value.compare(0, 5, "ws://") != 0){
+        return false;
+    }
+    value = value.substr(5);
+    size_t slash = value.find('/');
+    if(slash != string::npos){
+        options.path = value.substr(slash);
+        value = value.substr(0, slash);
+    }
+    size_t colon = value.find(':');
+    if(colon != string::npos){
+        options.port = value.substr(colon + 1);
+        value = value.substr(0, colon);
+    }
+    options.host = value;
+    return !value.empty();
+}
+
+static void usage(){
+    printf(
+        "usage: simulator ws://host:port/path [options]\n"
+        "  --devices N        가상 기기 수(1000)\n"
+        "  --touch R          기기당 분당 터치 수(1)\n"
+        "  --drop R           기기당 분당 강제 연결 끊김 수(0)\n"
+        "  --storm T          T초에 모든 연결을 동시에 끊음\n"
+        "  --duration S       실행 시간(60)\n"
+        "  --version V        프로토콜 버전 1, 2(%d)\n"
+        "  --ramp N           초당 최초 연결 수(500)\n"
+        "  --reconnect MS     재연결 대기, 백오프 사용 시 첫 대기 시간(1000)\n"
+        "  --backoff 0|1      지수 백오프 사용, 0이면 고정 간격(1)\n"
+        "  --ping MS          ping 간격, 0이면 사용 안 함(10000)\n"
+        "  --report S         통계 출력 간격(5)\n",
+        PROTOCOL_VERSION
+    );
+}
+
+int main(int argc, char** argv){
+    if(argc < 2 || !parseUrl(argv[1])){
+        usage();
+        return 1;
+    }
+    for(int i = 2; i + 1 < argc; i += 2){
+        string key = argv[i];
+        double value = atof(argv[i + 1]);
+        if(key == "--devices"){
+            options.devices = value;
+        }else if(key == "--touch"){
+            options.touchRate = value;
+        }else if(key == "--drop"){
+            options.dropRate = value;
+        }else if(key == "--storm"){
+            options.stormAt = value;
+        }else if(key == "--duration"){
+            options.duration = value;
+        }else if(key == "--version"){
+            options.version = value;
+        }else if(key == "--ramp"){
+            options.rampRate = value;
+        }else if(key == "--reconnect"){
+            options.reconnectDelay = value;
+        }else if(key == "--backoff"){
+            options.backoff = value != 0;
+        }else if(key == "--ping"){
+            options.pingInterval = value;
+        }else if(key == "--report" && value >= 1){
+            options.reportInterval = value;
+        }else{
+            usage();
+            return 1;
+        }
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if(getaddrinfo(options.host.c_str(), options.port.c_str(), &hints, &address) != 0){
+        printf("주소를 찾을 수 없습니다: %s\n", options.host.c_str());
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    epoll = epoll_create1(0);
+
+    // 기기 ID는 번호로 정해 재실행해도 같은 ID 사용(영문 5자리_숫자 4자리)
+    devices.resize(options.devices);
+    for(uint32_t i = 0; i < options.devices; ++i){
+        devices[i].reconnect.base = options.reconnectDelay;
+        uint32_t value = i;
+        for(int8_t j = 4; j >= 0; --j){
+            devices[i].id[j] = 'a' + value % 26;
+            value /= 26;
+        }
+        devices[i].id[5] = '_';
+        snprintf(devices[i].id + 6, 5, "%04u", (i / 11881376) % 10000);
+        schedule(i, CONNECT, (int64_t) i * 1000000 / options.rampRate);
+    }
+
+    int64_t start = now();
+    int64_t end = start + options.duration * 1000000LL;
+    int64_t nextReport = start + options.reportInterval * 1000000LL;
+    bool stormed = options.stormAt == 0;
+    counters_t last = {};
+    epoll_event events[1024];
+    char buffer[SIM_READ_SIZE];
+    while(now() < end){
+        int64_t current = now();
+        while(!timers.empty() && timers.top().time <= current){
+            sim_timer_t timer = timers.top();
+            timers.pop();
+            handleTimer(timer);
+        }
+        if(!stormed && current - start >= options.stormAt * 1000000LL){
+            stormed = true;
+            printf("[storm] 모든 연결을 끊습니다(online: %u)\n", online);
+            for(uint32_t i = 0; i < options.devices; ++i){
+                disconnect(i, true);
+            }
+        }
+        if(current >= nextReport){
+            report("sim", (current - start) / 1e6, last);
+            nextReport += options.reportInterval * 1000000LL;
+        }
+
+        int64_t wait = timers.empty() ? 100000 : timers.top().time - now();
+        int timeout = (int) (wait < 0 ? 0 : wait > 100000 ? 100 : (wait + 999) / 1000);
+        int count = epoll_wait(epoll, events, 1024, timeout);
+        for(int i = 0; i < count; ++i){
+            uint32_t index = events[i].data.u32;
+            device_t& device = devices[index];
+            if(device.fd < 0){
+                continue;
+            }
+            if(events[i].events & (EPOLLERR | EPOLLHUP)){
+                ++(device.state == CONNECTING ? counters.failures : counters.closed);
+                disconnect(index, true);
+                continue;
+            }
+            if(device.state == CONNECTING && (events[i].events & EPOLLOUT)){
+                upgrade(index);
+                epoll_event event = {};
+                event.events = EPOLLIN;
+                event.data.u32 = index;
+                epoll_ctl(epoll, EPOLL_CTL_MOD, device.fd, &event);
+            }
+            if(events[i].events & EPOLLIN){
+                ssize_t length = recv(device.fd, buffer, sizeof(buffer), 0);
+                if(length <= 0){
+                    if(length == 0 || errno != EAGAIN){
+                        ++counters.closed;
+                        disconnect(index, true);
+                    }
+                    continue;
+                }
+                counters.received += length;
+                device.input.append(buffer, length);
+                parse(index);
+            }
+            flush(index);
+        }
+    }
+
+    report("total", (now() - start) / 1e6, last);
+    printHistogram("connect", connectLatency);
+    printHistogram("handshake", handshakeLatency);
+    printHistogram("ping", pingLatency);
+    printf("connects: %llu, reconnects: %llu, failures: %llu, server closed: %llu, welcomes: %llu, resumed: %llu/%llu\n",
+        (unsigned long long) counters.connects, (unsigned long long) counters.reconnects,
+        (unsigned long long) counters.failures, (unsigned long long) counters.closed, (unsigned long long) counters.welcomes,
+        (unsigned long long) counters.resumed, (unsigned long long) counters.resumes
+    );
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,399 @@
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "trace.h"
+#include "detector.h"
+
+// capture.h로 기록한 터치 원시값을 여러 판정 알고리즘으로 다시 돌려 정답(라벨)과 비교
+// 입력: 바이너리 기록(CAPTURE_DATA_V2를 이어 붙인 것) 또는 "[Capture] <offset> <hex>" 줄이 있는 시리얼 로그
+// ./build-native/touch_replay monitor.log --labels labels.csv
+// ./build-native/touch_replay --synth synth.trc && ./build-native/touch_replay synth.trc --labels synth.trc.csv
+
+using namespace std;
+
+#define REPLAY_MARGIN 2500 // 기준값 약 31000에서 touch.h TOUCH_RATIO로 계산한 차이
+#define REPLAY_EARLY 50 // ms, 라벨 시작보다 이만큼 빠른 판정까지 인정
+#define ORACLE_MEDIAN 5 // 측정 수
+#define ORACLE_WINDOW 4000 // ms, 기준값 추정 구간
+#define ORACLE_PERCENTILE 20
+#define ORACLE_MIN_DURATION 30 // ms
+
+typedef struct{
+    uint8_t channel;
+    uint32_t start; // ms
+    uint32_t end;
+} label_t;
+
+typedef struct{
+    string name;
+    uint32_t hits = 0;
+    uint32_t missed = 0;
+    uint32_t falses = 0; // 라벨 밖이거나 같은 라벨에 두 번째 판정
+    vector<uint32_t> latencies; // ms, 라벨 시작부터 판정까지
+} result_t;
+
+static bool readFile(const char* path, vector<uint8_t>& data){
+    FILE* file = fopen(path, "rb");
+    if(file == NULL){
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t length;
+    while((length = fread(buffer, 1, sizeof(buffer), file)) > 0){
+        data.insert(data.end(), buffer, buffer + length);
+    }
+    fclose(file);
+    return true;
+}
+
+// 시리얼 로그에서 조각을 offset 위치에 맞춰 조립, 중간에 다른 로그가 섞여 있어도 됨
+static bool parseLog(const vector<uint8_t>& log, vector<uint8_t>& trace){
+    string text(log.begin(), log.end());
+    size_t position = 0;
+    bool found = false;
+    while((position = text.find("[Capture] ", position)) != string::npos){
+        position += 10;
+        char* end;
+        unsigned long offset = strtoul(text.c_str() + position, &end, 10);
+        if(end == text.c_str() + position || *end != ' '){
+            continue; // 시작, 종료 로그
+        }
+        position = end - text.c_str() + 1;
+        vector<uint8_t> chunk;
+        while(position + 1 < text.size() && isxdigit(text[position]) && isxdigit(text[position + 1])){
+            chunk.push_back(stoi(text.substr(position, 2), NULL, 16));
+            position += 2;
+        }
+        if(trace.size() < offset + chunk.size()){
+            trace.resize(offset + chunk.size());
+        }
+        copy(chunk.begin(), chunk.end(), trace.begin() + offset);
+        found = true;
+    }
+    return found;
+}
+
+static bool readLabels(const char* path, vector<label_t>& labels){
+    FILE* file = fopen(path, "r");
+    if(file == NULL){
+        return false;
+    }
+    char line[128];
+    while(fgets(line, sizeof(line), file) != NULL){
+        unsigned channel, start, end;
+        if(sscanf(line, "%u,%u,%u", &channel, &start, &end) == 3){
+            labels.push_back({(uint8_t) channel, start, end});
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// 라벨이 없을 때 전체 기록을 보고 정하는 오프라인 정답: 중앙값 필터 -> 주변 구간 하위 백분위 기준값 -> 히스테리시스
+// 실시간 판정은 미래 값을 볼 수 없으므로 이보다 나을 수 없다는 기준, 직접 기록한 라벨보다 부정확함
+static void oracle(const trace::header_t& header, const vector<trace::sample_t>& samples, uint32_t margin, vector<label_t>& labels){
+    size_t count = samples.size();
+    int32_t half = ORACLE_WINDOW / 2 / header.interval;
+    for(uint8_t channel = 0; channel < header.channelCount; ++channel){
+        vector<uint32_t> filtered(count);
+        for(size_t i = 0; i < count; ++i){
+            uint32_t window[ORACLE_MEDIAN];
+            uint8_t size = 0;
+            for(int32_t j = -ORACLE_MEDIAN / 2; j <= ORACLE_MEDIAN / 2; ++j){
+                if((int64_t) i + j >= 0 && i + j < count){
+                    window[size++] = samples[i + j].values[channel];
+                }
+            }
+            nth_element(window, window + size / 2, window + size);
+            filtered[i] = window[size / 2];
+        }
+
+        // 기준값은 10개마다 계산
+        vector<uint32_t> baselines(count);
+        vector<uint32_t> window;
+        for(size_t i = 0; i < count; ++i){
+            if(i % 10 == 0){
+                size_t from = i > (size_t) half ? i - half : 0;
+                size_t to = min(count, i + half + 1);
+                window.assign(filtered.begin() + from, filtered.begin() + to);
+                size_t rank = window.size() * ORACLE_PERCENTILE / 100;
+                nth_element(window.begin(), window.begin() + rank, window.end());
+                baselines[i] = window[rank];
+            }else{
+                baselines[i] = baselines[i - 1];
+            }
+        }
+
+        bool touched = false;
+        uint32_t start = 0;
+        for(size_t i = 0; i < count; ++i){
+            uint32_t time = samples[i].tick * header.interval;
+            if(!touched && filtered[i] > baselines[i] + margin / 2){
+                touched = true;
+                start = time;
+            }else if(touched && (filtered[i] < baselines[i] + margin / 4 || i + 1 == count)){
+                touched = false;
+                if(time - start >= ORACLE_MIN_DURATION){
+                    labels.push_back({channel, start, time});
+                }
+            }
+        }
+    }
+}
+
+// 잠금 시간은 switches::canToggle과 같이 마지막으로 반영된 판정 기준
+template<typename Detect>
+static vector<uint32_t> replay(const trace::header_t& header, const vector<trace::sample_t>& samples, uint8_t channel, Detect detect){
+    uint16_t lockout = channel < SWITCH_CHANNELS ? config::CHANNELS[channel].lockout : 0;
+    vector<uint32_t> detections;
+    for(const trace::sample_t& sample : samples){
+        uint32_t time = sample.tick * header.interval;
+        if(!detect(sample) || (!detections.empty() && time - detections.back() < lockout)){
+            continue;
+        }
+        detections.push_back(time);
+    }
+    return detections;
+}
+
+static void score(result_t& result, const vector<label_t>& labels, uint8_t channel, const vector<uint32_t>& detections){
+    vector<const label_t*> pending;
+    for(const label_t& label : labels){
+        if(label.channel == channel){
+            pending.push_back(&label);
+        }
+    }
+    vector<bool> matched(pending.size(), false);
+    for(uint32_t time : detections){
+        bool hit = false;
+        for(size_t i = 0; i < pending.size(); ++i){
+            if(!matched[i] && time + REPLAY_EARLY >= pending[i]->start && time <= pending[i]->end){
+                matched[i] = true;
+                hit = true;
+                ++result.hits;
+                result.latencies.push_back(time > pending[i]->start ? time - pending[i]->start : 0);
+                break;
+            }
+        }
+        if(!hit){
+            ++result.falses;
+        }
+    }
+    result.missed += count(matched.begin(), matched.end(), false);
+}
+
+static uint32_t percentile(vector<uint32_t> values, uint16_t permille){
+    if(values.empty()){
+        return 0;
+    }
+    sort(values.begin(), values.end());
+    return values[min(values.size() - 1, ((size_t) values.size() * permille + 999) / 1000 - 1)];
+}
+
+// 채널 2개, 기준값 드리프트(습도, 온도) + 잡음 + 무작위 터치, 기기 판정은 폴링 모드의 고정 기준값 방식
+static int synthesize(const char* path, uint32_t seconds, uint32_t seed, uint32_t margin){
+    mt19937 random(seed);
+    normal_distribution<double> noise(0, 150);
+    uniform_real_distribution<double> uniform(0, 1);
+
+    trace::header_t header = {
+        .channelCount = 2,
+        .interval = 10,
+        .baselines = {30000, 42000},
+    };
+    vector<label_t> labels;
+    double level[2] = {0, 0};
+    uint32_t next[2] = {1000, 1700};
+    uint32_t touchEnd[2] = {0, 0};
+    uint32_t touchStart[2] = {0, 0};
+    double amplitude[2] = {0, 0};
+    detector::Threshold device[2] = {detector::Threshold(margin), detector::Threshold(margin)};
+    device[0].calibrate(header.baselines[0]);
+    device[1].calibrate(header.baselines[1]);
+    header.baselines[0] = device[0].baseline();
+    header.baselines[1] = device[1].baseline();
+
+    vector<uint8_t> data;
+    uint8_t chunk[4096];
+    protocol::Writer writer(chunk, sizeof(chunk));
+    trace::encodeHeader(writer, header);
+    trace::Encoder encoder(header);
+    for(uint32_t tick = 0; tick * header.interval < seconds * 1000; ++tick){
+        uint32_t time = tick * header.interval;
+        trace::sample_t sample = {.tick = tick};
+        for(uint8_t channel = 0; channel < 2; ++channel){
+            if(time >= next[channel]){
+                touchStart[channel] = time;
+                touchEnd[channel] = time + 80 + uniform(random) * 320;
+                amplitude[channel] = margin * (1.2 + uniform(random) * 1.3);
+                next[channel] = touchEnd[channel] + 2000 + uniform(random) * 3000;
+                labels.push_back({channel, touchStart[channel], touchEnd[channel]});
+            }
+            // 손가락이 닿는 20ms 동안 상승, 떼면 20ms 동안 하강
+            double target = time >= touchStart[channel] && time < touchEnd[channel] ? amplitude[channel] : 0;
+            level[channel] += (target - level[channel]) * 0.5;
+            double drift = 1500 * sin(time / 60000.0 * 2 * M_PI + channel) + time / 1000.0 * (channel == 0 ? 20 : -10);
+            sample.values[channel] = (uint32_t) max(0.0, header.baselines[channel] - 100 + drift + level[channel] + noise(random));
+            if(device[channel].update(sample.values[channel])){
+                sample.events |= 1 << channel;
+            }
+        }
+        if(writer.capacity - writer.length < TRACE_RECORD_MAX){
+            data.insert(data.end(), chunk, chunk + writer.length);
+            writer = protocol::Writer(chunk, sizeof(chunk));
+        }
+        encoder.encode(writer, sample);
+    }
+    data.insert(data.end(), chunk, chunk + writer.length);
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL){
+        printf("파일을 만들 수 없습니다: %s\n", path);
+        return 1;
+    }
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+
+    string labelPath = string(path) + ".csv";
+    file = fopen(labelPath.c_str(), "w");
+    if(file == NULL){
+        printf("파일을 만들 수 없습니다: %s\n", labelPath.c_str());
+        return 1;
+    }
+    fprintf(file, "channel,start_ms,end_ms\n");
+    for(const label_t& label : labels){
+        fprintf(file, "%u,%u,%u\n", label.channel, label.start, label.end);
+    }
+    fclose(file);
+    printf("%s: %zu bytes, %u초, 라벨 %zu개 -> %s\n", path, data.size(), seconds, labels.size(), labelPath.c_str());
+    return 0;
+}
+
+static void usage(){
+    printf(
+        "usage: touch_replay <trace|serial log> [options]\n"
+        "       touch_replay --synth <out.trc> [--seconds S] [--seed N]\n"
+        "  --labels FILE      정답 CSV(channel,start_ms,end_ms), 없으면 오프라인 추정\n"
+        "  --margin N         터치 판단 차이(%d)\n",
+        REPLAY_MARGIN
+    );
+}
+
+int main(int argc, char** argv){
+    if(argc < 2){
+        usage();
+        return 1;
+    }
+    const char* input = argv[1];
+    const char* labelPath = NULL;
+    const char* synthPath = NULL;
+    uint32_t margin = REPLAY_MARGIN;
+    uint32_t seconds = 120;
+    uint32_t seed = 1;
+    int first = 2;
+    if(strcmp(argv[1], "--synth") == 0 && argc >= 3){
+        synthPath = argv[2];
+        first = 3;
+    }
+    for(int i = first; i + 1 < argc; i += 2){
+        string key = argv[i];
+        if(key == "--labels"){
+            labelPath = argv[i + 1];
+        }else if(key == "--margin"){
+            margin = atoi(argv[i + 1]);
+        }else if(key == "--seconds"){
+            seconds = atoi(argv[i + 1]);
+        }else if(key == "--seed"){
+            seed = atoi(argv[i + 1]);
+        }else{
+            usage();
+            return 1;
+        }
+    }
+    if(synthPath != NULL){
+        return synthesize(synthPath, seconds, seed, margin);
+    }
+
+    vector<uint8_t> file, data;
+    if(!readFile(input, file)){
+        printf("파일을 열 수 없습니다: %s\n", input);
+        return 1;
+    }
+    if(file.size() >= 4 && memcmp(file.data(), TRACE_MAGIC, 4) == 0){
+        data.swap(file);
+    }else if(!parseLog(file, data)){
+        printf("기록을 찾을 수 없습니다: %s\n", input);
+        return 1;
+    }
+
+    trace::Decoder decoder(data.data(), data.size());
+    if(!decoder.begin()){
+        printf("기록 형식이 올바르지 않습니다.\n");
+        return 1;
+    }
+    const trace::header_t& header = decoder.header;
+    vector<trace::sample_t> samples;
+    trace::sample_t sample;
+    while(decoder.next(sample)){
+        samples.push_back(sample);
+    }
+    if(decoder.offset < data.size()){
+        printf("기록이 %u bytes에서 잘렸습니다.\n", decoder.offset);
+    }
+    if(samples.empty()){
+        printf("측정값이 없습니다.\n");
+        return 1;
+    }
+
+    vector<label_t> labels;
+    if(labelPath != NULL){
+        if(!readLabels(labelPath, labels)){
+            printf("라벨 파일을 열 수 없습니다: %s\n", labelPath);
+            return 1;
+        }
+    }else{
+        oracle(header, samples, margin, labels);
+    }
+    printf("channel: %u, interval: %ums, 측정 %zu개(%.1fs), 라벨 %zu개(%s)\n", header.channelCount, header.interval, samples.size(),
+        samples.back().tick * header.interval / 1000.0, labels.size(), labelPath != NULL ? "파일" : "오프라인 추정");
+
+    result_t results[3];
+    results[0].name = "device";
+    results[1].name = "threshold";
+    results[2].name = "adaptive";
+    for(uint8_t channel = 0; channel < header.channelCount; ++channel){
+        uint8_t bit = 1 << channel;
+        // 기록에 남은 기기 판정
+        score(results[0], labels, channel, replay(header, samples, channel, [&](const trace::sample_t& sample){
+            return (sample.events & bit) != 0;
+        }));
+
+        // 폴링 모드 방식, 기기가 쓰던 기준값에서 시작
+        detector::Threshold threshold(margin);
+        threshold.threshold = header.baselines[channel];
+        score(results[1], labels, channel, replay(header, samples, channel, [&](const trace::sample_t& sample){
+            return threshold.update(sample.values[channel]);
+        }));
+
+        // S3 하드웨어 기준값 추적을 흉내 낸 방식(IIR 1/16, 2회 연속 확인, 절반 아래로 내려가야 해제)
+        detector::Adaptive<4> adaptive(margin, margin / 2, 2);
+        adaptive.calibrate(header.baselines[channel]);
+        score(results[2], labels, channel, replay(header, samples, channel, [&](const trace::sample_t& sample){
+            return adaptive.update(sample.values[channel]);
+        }));
+    }
+
+    printf("%-10s %6s %6s %6s %9s %9s %9s\n", "algorithm", "hit", "miss", "false", "p50(ms)", "p90(ms)", "max(ms)");
+    for(const result_t& result : results){
+        printf("%-10s %6u %6u %6u %9u %9u %9u\n", result.name.c_str(), result.hits, result.missed, result.falses,
+            percentile(result.latencies, 500), percentile(result.latencies, 900), percentile(result.latencies, 1000));
+    }
+    return 0;
+}
\ No newline at end of file
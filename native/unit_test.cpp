@@ -0,0 +1,337 @@
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal.h"
+#include "form.h"
+#include "touch.h"
+#include "battery.h"
+#include "reactor.h"
+#include "storage.h"
+#include "protocol.h"
+#include "switches.h"
+
+// 호스트 단위 테스트(시뮬레이션 시간, 메모리 NVS, 지정한 터치/ADC 값), 실패한 검사를 모두 출력하고 1을 반환
+// ctest --test-dir build-native
+
+using namespace std;
+
+static uint32_t failures = 0;
+
+#define CHECK(condition) do{ \
+    if(!(condition)){ \
+        ++failures; \
+        printf("%s:%d: CHECK(%s) 실패\n", __FILE__, __LINE__, #condition); \
+    } \
+}while(0)
+
+// 예약된 이벤트를 처리(deviceTask 대신)
+static uint32_t drainReactor(){
+    uint32_t flushes = 0;
+    reactor::event_t event;
+    while(reactor::wait(&event, 0)){
+        if(event.type == reactor::STORAGE_FLUSH){
+            storage::flush();
+            ++flushes;
+        }
+    }
+    return flushes;
+}
+
+static const storage::data_t* stored(){
+    auto entry = hal::flash().find("switch_bot/" STORAGE_KEY);
+    if(entry == hal::flash().end() || entry->second.size() != sizeof(storage::data_t)){
+        return NULL;
+    }
+    return (const storage::data_t*) entry->second.data();
+}
+
+static void switchTest(){
+    hal::setMicros(1000 * 1000);
+    for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+        switches::words[i] = 0;
+    }
+
+    CHECK(switches::set(0, true, protocol::ORIGIN_SERVER));
+    CHECK(!switches::set(0, true, protocol::ORIGIN_SERVER));
+    switches::snapshot_t snapshot = switches::load(0);
+    CHECK(snapshot.state && snapshot.version == 1 && snapshot.origin == protocol::ORIGIN_SERVER && snapshot.time == 1000);
+    CHECK(switches::bits() == 0b01);
+    CHECK(!switches::set(SWITCH_CHANNELS, true));
+
+    // lockout 안의 터치는 무시
+    bool state;
+    CHECK(!switches::canToggle(0, 500));
+    CHECK(!switches::toggle(0, 500, protocol::ORIGIN_TOUCH, state));
+    hal::advance(500 * 1000);
+    CHECK(switches::toggle(0, 500, protocol::ORIGIN_TOUCH, state) && !state);
+    CHECK(switches::load(0).version == 2 && switches::load(0).origin == protocol::ORIGIN_TOUCH);
+
+    // 서버가 본 버전 이후 변경이 있으면 버림
+    CHECK(switches::setIf(0, true, protocol::ORIGIN_SERVER, 1) == switches::STALE);
+    CHECK(switches::setIf(0, false, protocol::ORIGIN_SERVER, 2) == switches::UNCHANGED);
+    CHECK(switches::setIf(0, true, protocol::ORIGIN_SERVER, 3) == switches::STALE);
+    CHECK(switches::setIf(0, true, protocol::ORIGIN_SERVER, 2) == switches::APPLIED);
+    CHECK(switches::load(0).version == 3 && switches::get(0));
+
+    // 부팅 시 복원은 버전을 올리지 않고 터치를 막지 않음
+    hal::setMicros(0);
+    uint32_t version = switches::epochVersion(2);
+    CHECK(version == 2 << SWITCH_EPOCH_SHIFT && version > switches::epochVersion(1));
+    switches::restore(1, true, version);
+    snapshot = switches::load(1);
+    CHECK(snapshot.state && snapshot.version == version && snapshot.origin == protocol::ORIGIN_RESTORE);
+    CHECK(switches::canToggle(1, 1000));
+    CHECK(switches::setIf(1, false, protocol::ORIGIN_SERVER, 5) == switches::STALE);
+    CHECK(switches::setIf(1, false, protocol::ORIGIN_SERVER, version) == switches::APPLIED);
+    CHECK(switches::load(1).version == version + 1);
+
+    // pack/unpack 경계값
+    switches::snapshot_t full = {true, 7, 0x0FFFFFFF, UINT32_MAX};
+    switches::snapshot_t unpacked = switches::unpack(switches::pack(full));
+    CHECK(unpacked.state && unpacked.origin == 7 && unpacked.version == 0x0FFFFFFF && unpacked.time == UINT32_MAX);
+}
+
+static void storageTest(){
+    hal::flash().clear();
+    hal::setMicros(0);
+
+    // 이전 버전이 개별 키로 저장한 값
+    hal::Nvs legacy;
+    legacy.open("switch_bot");
+    legacy.setString("DEVICE_ID", "abcde_1234");
+    storage::ap_cache_t cache = {{1, 2, 3, 4, 5, 6}, 11};
+    legacy.setBlob("wifi_cache", &cache, sizeof(cache));
+
+    CHECK(storage::begin());
+    CHECK(strcmp(storage::getDeviceId(), "abcde_1234") == 0);
+    storage::ap_cache_t restored;
+    CHECK(storage::getApCache(&restored) && memcmp(&restored, &cache, sizeof(cache)) == 0);
+    CHECK(hal::flash().count("switch_bot/DEVICE_ID") == 0 && hal::flash().count("switch_bot/wifi_cache") == 0);
+    CHECK(stored() != NULL && stored()->version == STORAGE_VERSION);
+
+    // 부팅 번호는 바로 저장
+    CHECK(storage::nextEpoch() == 1 && stored()->bootEpoch == 1);
+
+    // 변경은 STORAGE_FLUSH_DELAY 뒤 한 번에 저장
+    storage::setSwitchStates(0b10);
+    storage::setSwitchStates(0b11);
+    CHECK(stored()->switchStates == 0);
+    hal::advance((STORAGE_FLUSH_DELAY - 1) * 1000LL);
+    CHECK(drainReactor() == 0);
+    hal::advance(1000);
+    CHECK(drainReactor() == 1);
+    CHECK(stored()->switchStates == 0b11);
+    CHECK(storage::getSwitchStates() == 0b11);
+
+    // 저장에 실패하면 다음 flush에서 다시 저장
+    hal::flashFailing() = true;
+    storage::clearApCache();
+    CHECK(!storage::flush());
+    hal::flashFailing() = false;
+    CHECK(stored()->hasApCache);
+    CHECK(storage::flush());
+    CHECK(!stored()->hasApCache);
+
+    // 일회성 일정 삭제
+    protocol::schedule_entry_t entries[] = {
+        {1, 0, 60, 0, protocol::SCHEDULE_ON},
+        {2, 0x7F, 120, 1, protocol::SCHEDULE_OFF},
+    };
+    storage::setSchedules(entries, 2);
+    storage::removeSchedule(entries[0]);
+    storage::removeSchedule(entries[0]);
+    protocol::schedule_entry_t loaded[PROTOCOL_MAX_SCHEDULES];
+    CHECK(storage::getSchedules(loaded) == 1 && loaded[0].id == 2);
+    CHECK(storage::flush() && stored()->scheduleCount == 1);
+
+    // 재부팅: 저장된 값을 그대로 읽음
+    storage::data_t before = *stored();
+    CHECK(storage::begin());
+    CHECK(memcmp(stored(), &before, sizeof(before)) == 0);
+    CHECK(storage::getSwitchStates() == 0b11 && strcmp(storage::getDeviceId(), "abcde_1234") == 0);
+
+    CHECK(storage::nextEpoch() == 2);
+
+    // 이전 버전 blob은 추가된 필드만 초기화
+    storage::data_t v2 = before;
+    v2.version = 2;
+    hal::flash()["switch_bot/" STORAGE_KEY].assign((uint8_t*) &v2, (uint8_t*) &v2 + storage::V2_SIZE);
+    CHECK(storage::begin());
+    CHECK(stored() != NULL && stored()->version == STORAGE_VERSION && stored()->scheduleCount == 1 && stored()->bootEpoch == 0);
+    CHECK(storage::getSwitchStates() == 0b11 && strcmp(storage::getDeviceId(), "abcde_1234") == 0);
+
+    storage::data_t v1 = before;
+    v1.version = 1;
+    hal::flash()["switch_bot/" STORAGE_KEY].assign((uint8_t*) &v1, (uint8_t*) &v1 + storage::V1_SIZE);
+    CHECK(storage::begin());
+    CHECK(stored() != NULL && stored()->version == STORAGE_VERSION && stored()->scheduleCount == 0);
+    CHECK(storage::getSwitchStates() == 0b11 && strcmp(storage::getDeviceId(), "abcde_1234") == 0);
+
+    // 알 수 없는 형식이면 새 기기 ID 생성
+    hal::flash().clear();
+    CHECK(storage::begin());
+    const char* id = storage::getDeviceId();
+    CHECK(strlen(id) == STORAGE_DEVICE_ID_LENGTH && id[5] == '_' && id[0] >= 'a' && id[0] <= 'z' && id[9] >= '0' && id[9] <= '9');
+    CHECK(storage::getSwitchStates() == 0 && !storage::getApCache(&restored));
+    drainReactor();
+}
+
+// 나뉘어 도착한 입력을 한 번에 받은 것과 같게 처리
+static bool parse(form::field_t* fields, uint8_t count, const char* body, size_t chunk){
+    form::Parser parser(fields, count);
+    size_t length = strlen(body);
+    for(size_t offset = 0; offset < length; offset += chunk){
+        if(!parser.feed(body + offset, MIN(length - offset, chunk))){
+            return false;
+        }
+    }
+    return parser.finish();
+}
+
+static void formTest(){
+    char ssid[33];
+    char password[9];
+    form::field_t fields[] = {
+        {"ssid", ssid, sizeof(ssid)},
+        {"password", password, sizeof(password)},
+    };
+
+    for(size_t chunk : {(size_t) 1, (size_t) 3, (size_t) 64}){
+        CHECK(parse(fields, 2, "ssid=My+Home%20%EA%B0%80&other=%ZZ&password=p%40ss", chunk));
+        CHECK(strcmp(ssid, "My Home \xEA\xB0\x80") == 0 && fields[0].found && fields[0].length == 11);
+        CHECK(strcmp(password, "p@ss") == 0 && fields[1].found);
+    }
+
+    CHECK(parse(fields, 2, "ssid=a&ssid=b", 64) && strcmp(ssid, "b") == 0 && !fields[1].found);
+    CHECK(!parse(fields, 2, "ssid=%G0", 64));
+    CHECK(!parse(fields, 2, "ssid=a%00b", 64));
+    CHECK(!parse(fields, 2, "ssid=ab%4", 64));
+    CHECK(!parse(fields, 2, "ssid=a%4&password=b", 64));
+    CHECK(parse(fields, 2, "password=12345678", 64));
+    CHECK(!parse(fields, 2, "password=123456789", 64));
+}
+
+static void protocolTest(){
+    uint8_t buffer[128];
+    uint8_t entries[] = {protocol::entry(0, true), protocol::entry(3, false)};
+
+    protocol::command_t command = {
+        .version = 2,
+        .sequence = 0xBEEF,
+        .count = 2,
+        .entries = entries,
+    };
+    protocol::Writer writer(buffer, sizeof(buffer));
+    CHECK(protocol::encodeCommand(writer, command));
+    protocol::command_t decoded;
+    CHECK(protocol::decodeCommand(buffer, writer.length, decoded));
+    CHECK(decoded.version == 2 && decoded.sequence == 0xBEEF && decoded.count == 2);
+    CHECK(protocol::entryChannel(protocol::entryAt(decoded, 1)) == 3 && !protocol::entryState(protocol::entryAt(decoded, 1)));
+    for(uint16_t length = 2; length < writer.length; ++length){
+        CHECK(!protocol::decodeCommand(buffer, length, decoded));
+    }
+
+    // 1바이트는 v1 명령
+    CHECK(protocol::decodeCommand(entries, 1, decoded) && decoded.version == 1 && protocol::entryChannel(protocol::entryAt(decoded, 0)) == 0);
+
+    protocol::versioned_t versioned = {.sequence = 7, .battery = 9, .count = 2};
+    versioned.entries[0] = {protocol::entry(1, true), protocol::ORIGIN_TOUCH, 0x0FFFFFFF};
+    versioned.entries[1] = {protocol::entry(0, false), protocol::ORIGIN_SCHEDULE, 0};
+    writer = protocol::Writer(buffer, sizeof(buffer));
+    CHECK(protocol::encodeSwitchVersion(writer, versioned));
+    protocol::versioned_t state;
+    CHECK(protocol::decodeSwitchVersion(buffer, writer.length, state));
+    CHECK(state.sequence == 7 && state.count == 2 && state.entries[0].version == 0x0FFFFFFF && state.entries[0].origin == protocol::ORIGIN_TOUCH);
+    CHECK(state.entries[1].entry == protocol::entry(0, false) && state.entries[1].version == 0);
+    CHECK(!protocol::decodeSwitchVersion(buffer, writer.length - 1, state));
+
+    protocol::schedule_t schedule = {.sequence = 3, .count = 1};
+    schedule.entries[0] = {5, 0b0111110, 1439, 1, protocol::SCHEDULE_TOGGLE};
+    writer = protocol::Writer(buffer, sizeof(buffer));
+    CHECK(protocol::encodeScheduleSet(writer, schedule));
+    protocol::schedule_t received;
+    CHECK(protocol::decodeScheduleSet(buffer, writer.length, received));
+    CHECK(received.sequence == 3 && received.count == 1 && memcmp(&received.entries[0], &schedule.entries[0], sizeof(schedule.entries[0])) == 0);
+
+    // 버퍼가 부족하면 실패
+    uint8_t small[3];
+    writer = protocol::Writer(small, sizeof(small));
+    CHECK(!protocol::encodeCommand(writer, command));
+}
+
+static void touchTest(){
+    hal::setMicros(0);
+    const uint8_t pins[] = {2, 3};
+    hal::touchValue(2) = 30040;
+    hal::touchValue(3) = 50000;
+    touch::begin(pins, 2);
+    CHECK(touch::baseline(0) == 30100 && touch::baseline(1) == 50100);
+    CHECK(hal::millis() >= 300);
+
+    // 판정 차이는 패드별 기준값에 비례
+    uint32_t margin0 = 30100 * TOUCH_RATIO / 1000;
+    uint32_t margin1 = 50100 * TOUCH_RATIO / 1000;
+    CHECK(touch::detectors[0].margin == margin0 && touch::detectors[1].margin == margin1);
+    CHECK(touch::marginOf(100) == TOUCH_MIN_MARGIN);
+
+    // 기준값 + margin을 넘는 순간만 터치
+    CHECK(!touch::detectors[1].update(50100 + margin1));
+    hal::touchValue(3) = 50100 + margin1 + 1;
+    int64_t before = hal::micros();
+    CHECK(touch::wait() == 0b10);
+    CHECK(touch::touchTime[1] == before);
+    hal::touchValue(2) = 30100 + margin0 + 1;
+    CHECK(touch::wait() == 0b01);
+    CHECK(touch::raw(0) == 30100 + margin0 + 1);
+
+    // deep sleep 전에 저장한 기준값 복원
+    const uint32_t baselines[] = {12300, 45600};
+    touch::begin(pins, 2, baselines);
+    CHECK(touch::baseline(0) == 12300 && touch::baseline(1) == 45600);
+    CHECK(touch::detectors[0].margin == TOUCH_MIN_MARGIN && touch::detectors[1].margin == 45600 * TOUCH_RATIO / 1000);
+}
+
+static void batteryTest(){
+    // 측정값이 없으면 이전 값 유지
+    hal::adcSamples().clear();
+    battery::update();
+    CHECK(battery::milliVolt == 0);
+
+    // 튀는 값은 중앙값으로 걸러짐
+    hal::adcSamples().assign(CHECK_COUNT, 2600);
+    hal::adcSamples()[0] = 0;
+    hal::adcSamples()[1] = 4095;
+    battery::update();
+    uint16_t mVolt = 2600 * 3100 / 4095 * BATTERY_DIVIDER_NUM / BATTERY_DIVIDER_DEN;
+    CHECK(battery::milliVolt == mVolt);
+    CHECK(battery::level == filter::levelOf(battery::curve, sizeof(battery::curve) / sizeof(battery::curve[0]), mVolt));
+    CHECK(battery::level == 8);
+
+    // EMA: 1/4씩 따라감
+    hal::adcSamples().assign(CHECK_COUNT, 2400);
+    battery::update();
+    CHECK(battery::milliVolt < mVolt && battery::milliVolt > 2400 * 3100 / 4095 * BATTERY_DIVIDER_NUM / BATTERY_DIVIDER_DEN);
+
+    // 배터리가 없는 장치
+    hal::adcSamples().assign(CHECK_COUNT, 10);
+    for(uint8_t i = 0; i < 32; ++i){
+        battery::update();
+    }
+    CHECK(battery::level == 15);
+}
+
+int main(){
+    switchTest();
+    storageTest();
+    formTest();
+    protocolTest();
+    touchTest();
+    batteryTest();
+    if(failures > 0){
+        printf("unit_test: %u개 실패\n", failures);
+        return 1;
+    }
+    printf("unit_test: 모두 통과\n");
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+# 펌웨어 이미지가 가장 작은 OTA 슬롯(partitions_*.csv의 ota_N)에 들어가는지 확인, 넘으면 빌드 실패
+# 보드마다 파티션 표가 달라도(ESP32: 0x1F0000, XIAO: 3M) 어느 보드로든 OTA할 수 있도록 가장 작은 값 기준
+# PlatformIO: extra_scripts = post:ota_size.py, ESP-IDF: CMakeLists.txt에서 python ota_size.py <이미지> <프로젝트 경로>
+
+import glob
+import os
+import sys
+
+
+def parse(value):
+    value = value.strip()
+    scale = {'K': 1024, 'M': 1024 * 1024}.get(value[-1:].upper(), 1)
+    if scale > 1:
+        value = value[:-1]
+    return int(value, 0) * scale
+
+
+# (크기, 파일 이름), 가장 작은 OTA 슬롯
+def smallest_slot(root):
+    slots = []
+    for path in glob.glob(os.path.join(root, 'partitions_*.csv')):
+        with open(path) as table:
+            for line in table:
+                fields = [field.strip() for field in line.split('#')[0].split(',')]
+                if len(fields) >= 5 and fields[1] == 'app' and fields[2].startswith('ota_'):
+                    slots.append((parse(fields[4]), os.path.basename(path)))
+    return min(slots) if slots else None
+
+
+def check(image, root):
+    slot = smallest_slot(root)
+    if slot is None:
+        return True
+    size = os.path.getsize(image)
+    limit, table = slot
+    if size > limit:
+        print('Error: 이미지(%d bytes)가 OTA 슬롯(%s: %d bytes)보다 %d bytes 큽니다.' % (size, table, limit, size - limit))
+        return False
+    print('OTA slot: %d / %d bytes (%.1f%%, %s)' % (size, limit, size * 100 / limit, table))
+    return True
+
+
+if __name__ == '__main__':
+    root = sys.argv[2] if len(sys.argv) > 2 else os.path.dirname(os.path.abspath(sys.argv[0]))
+    sys.exit(0 if check(sys.argv[1], root) else 1)
+else:
+    Import('env')
+
+    def action(target, source, env):
+        return 0 if check(str(target[0]), env.subst('$PROJECT_DIR')) else 1
+
+    env.AddPostAction('$BUILD_DIR/${PROGNAME}.bin', action)
\ No newline at end of file
@@ -9,128 +9,233 @@
 #include <driver/gpio.h>
 #include <driver/touch_sensor.h>
 #include <atomic>
-#include <iostream>
-#include <utility>
+#include <string.h>
 
+#include "logger.h"
+#include "lan.h"
+#include "ota.h"
 #include "web.h"
 #include "wifi.h"
 #include "utils.h"
+#include "power.h"
 #include "servo.h"
+#include "touch.h"
 #include "storage.h"
+#include "schedule.h"
+#include "timesync.h"
+#include "telemetry.h"
+#include "switches.h"
 #include "battery.h"
+#include "reactor.h"
+#include "stats.h"
+#include "config.h"
+#include "profiler.h"
+#include "capture.h"
+#include "protocol.h"
 #include "websocket.h"
+#if POWER_MODE == POWER_MODE_DEEP_SLEEP
+#include "deepsleep.h"
+#endif
 
-// 본인 세팅값 하드코딩
-#define SERVO_UP_PIN GPIO_NUM_8
-#define SERVO_DOWN_PIN GPIO_NUM_9
-
-#define TOUCH_UP_PIN GPIO_NUM_2
-#define TOUCH_DOWN_PIN GPIO_NUM_3
+static_assert(SWITCH_CHANNELS <= TOUCH_MAX_PADS, "터치 패드 수 초과");
 
 using namespace std;
 
-atomic<bool> upSwitchState = false;
-atomic<uint64_t> upSwitchUpdateTime = 0;
+#define ACK_PENDING_MAX 8
 
-atomic<bool> downSwitchState = false;
-atomic<uint64_t> downSwitchUpdateTime = 0;
+static atomic<bool> servoPending = false; // 처리되지 않은 SWITCH_CHANGED가 큐에 있음
 
-void changeSwitchState(ledc_channel_t channel, bool state){
-    switch(channel){
-        case LEDC_CHANNEL_0:
-            if(state == upSwitchState){
-                break;                
-            }
-            upSwitchState = state;
-            upSwitchUpdateTime = millis();
-            break;
-        case LEDC_CHANNEL_1:
-            if(state == downSwitchState){
-                break;                
-            }
-            downSwitchState = state;
-            downSwitchUpdateTime = millis();
-            break;
-        default:
-            return;
+// 서보 이동 명령을 기다리는 서버 명령 응답(deviceTask에서만 사용)
+typedef struct{
+    uint16_t sequence;
+    protocol::ack_status_t status;
+    uint8_t mask; // 기다리는 채널
+    uint32_t versions[SWITCH_CHANNELS]; // 이 버전 이상이 서보에 반영되면 응답
+} pending_ack_t;
+
+static uint32_t servoVersions[SWITCH_CHANNELS]; // 서보에 반영한 switches 버전, 이동 중이면 갱신하지 않음
+static pending_ack_t pendingAcks[ACK_PENDING_MAX];
+static uint8_t pendingAckCount = 0;
+
+// switches에 반영된 변경을 서보, 저장소, 서버에 전달
+// 서보와 저장소는 deviceTask가 최신 상태를 읽어 반영하므로 여러 번 바뀌어도 이벤트는 하나만 대기
+static void switchChanged(ledc_channel_t channel, bool state){
+    stats::stateTime[channel] = esp_timer_get_time();
+    if(!servoPending.exchange(true) && !reactor::post(reactor::SWITCH_CHANGED, channel)){
+        servoPending = false;
     }
-    if(ws::connectServer){
-        ws::sendSwitchState(channel, state);
+    ws::sendSwitchState(channel); // 연결되지 않았으면 다음 연결 때 전송(deep sleep이면 잠들 때 deepsleep이 보관)
+    LOG_INFO("[Servo] %d번 스위치 %s", channel, state ? "켜짐" : "꺼짐");
+}
+
+// 상태가 바뀌었으면 true
+bool changeSwitchState(ledc_channel_t channel, bool state, protocol::origin_t origin){
+    if(!switches::set(channel, state, origin)){
+        return false;
     }
-    cout << "[Servo] " << (channel ? "하단" : "상단") << " 스위치 " << (state ? "켜짐" : "꺼짐") << "\n";
+    switchChanged(channel, state);
+    return true;
 }
 
-void servoTask(void* args){
-    pair<bool, bool> servoState(false, false);
-    pair<int64_t, int64_t> lastServoTime(-1, -1);
+void touchTask(void* args){
+    uint8_t pins[SWITCH_CHANNELS];
+    for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+        pins[i] = config::CHANNELS[i].touchPin;
+    }
+#if POWER_MODE == POWER_MODE_DEEP_SLEEP
+    touch::begin(pins, SWITCH_CHANNELS, deepsleep::touchBaselines());
+#else
+    touch::begin(pins, SWITCH_CHANNELS);
+#endif
+
     for(;;){
-        if(lastServoTime.first != -1 && millis() - lastServoTime.first >= 200){
-            lastServoTime.first = -1;
-            servo::turnOff(LEDC_CHANNEL_0);
-        }
-        if(lastServoTime.second != -1 && millis() - lastServoTime.second >= 200){
-            lastServoTime.second = -1;
-            servo::turnOff(LEDC_CHANNEL_1);
+        uint32_t touched = touch::wait();
+        for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+            if(touched & (1 << i)){
+                capture::mark(i); // 잠금 시간 중 무시된 터치도 판정 결과로 기록
+            }
+            bool state;
+            if((touched & (1 << i)) && switches::toggle(i, config::CHANNELS[i].lockout, protocol::ORIGIN_TOUCH, state)){
+                switchChanged((ledc_channel_t) i, state);
+                touch::handled(i);
+            }
         }
+    }
+}
 
-        if(upSwitchState != servoState.first){
-            lastServoTime.first = millis();
-            servoState.first = upSwitchState;
-            servo::setAngle(LEDC_CHANNEL_0, upSwitchState ? 0 : 180); // 본인 세팅값 하드코딩
+// 서버(웹소켓), LAN에서 받은 명령을 반영, 바뀐 상태는 서버 세션에도 전송됨
+// mask: 명령이 대상으로 한 채널, 응답은 이 채널들의 서보 이동 명령 후 전송
+static protocol::ack_status_t applyCommand(const protocol::command_t& command, int64_t received, protocol::origin_t origin, uint8_t& mask){
+    protocol::ack_status_t status = protocol::ACK_OK;
+    mask = 0;
+    for(uint8_t i = 0; i < command.count; ++i){
+        uint8_t entry = protocol::entryAt(command, i);
+        ledc_channel_t channel = (ledc_channel_t) protocol::entryChannel(entry);
+        if(!switches::valid(channel)){
+            status = protocol::ACK_INVALID;
+            continue;
         }
-        if(downSwitchState != servoState.second){
-            lastServoTime.second = millis();
-            servoState.second = downSwitchState;
-            servo::setAngle(LEDC_CHANNEL_1, downSwitchState ? 180 : 0); // 본인 세팅값 하드코딩
+        mask |= 1 << channel;
+        if(changeSwitchState(channel, protocol::entryState(entry), origin)){
+            stats::record(stats::COMMAND_TO_STATE, received);
         }
     }
+    return status;
 }
 
-void touchTask(void* args){
-    uint64_t sum1 = 0, sum2 = 0;
-    uint64_t count1 = 0, count2 = 0;
-
-    uint64_t time = millis();
-    while(millis() - time <= 300){
-        ++count1;
-        ++count2;
-        sum1 += touchRead(TOUCH_UP_PIN);
-        sum2 += touchRead(TOUCH_DOWN_PIN);
-    }
-    uint32_t thresholdUp = sum1 / 100 / count1 * 100 + 100, thresholdDown = sum2 / 100 / count2 * 100 + 100;
-    cout << "[calibration] touch1: " << thresholdUp << ", touch2: " << thresholdDown << "\n";
+static protocol::ack_status_t applyLanCommand(const protocol::command_t& command, int64_t received){
+    uint8_t mask;
+    return applyCommand(command, received, protocol::ORIGIN_LAN, mask);
+}
 
-    pair<bool, bool> touch(false, false);
-    for(;;){
-        if(touchRead(TOUCH_UP_PIN) > thresholdUp + 2500){
-            if(!touch.first && millis() - upSwitchUpdateTime >= 500){
-                touch.first = true;
-                changeSwitchState(LEDC_CHANNEL_0, !upSwitchState);
-            }
-        }else{
-            touch.first = false;
+// 서버가 본 버전 이후 다른 변경(터치, 일정 등)이 있었던 채널은 버림, 서버는 함께 전송되는 현재 버전으로 다시 판단
+static protocol::ack_status_t applyVersionedCommand(const protocol::versioned_t& command, int64_t received, uint8_t& mask){
+    protocol::ack_status_t status = protocol::ACK_OK;
+    mask = 0;
+    bool subscribed = !outbox::versioned.exchange(true);
+    for(uint8_t i = 0; i < command.count; ++i){
+        const protocol::versioned_entry_t& entry = command.entries[i];
+        ledc_channel_t channel = (ledc_channel_t) protocol::entryChannel(entry.entry);
+        if(!switches::valid(channel)){
+            status = protocol::ACK_INVALID;
+            continue;
         }
-
-        if(touchRead(TOUCH_DOWN_PIN) > thresholdDown + 2500){
-            if(!touch.second && millis() - downSwitchUpdateTime >= 1000){
-                touch.second = true;
-                changeSwitchState(LEDC_CHANNEL_1, !downSwitchState);
-            }
-        }else{
-            touch.second = false;
+        bool state = protocol::entryState(entry.entry);
+        switch(switches::setIf(channel, state, protocol::ORIGIN_SERVER, entry.version)){
+            case switches::APPLIED:
+                mask |= 1 << channel;
+                switchChanged(channel, state);
+                stats::record(stats::COMMAND_TO_STATE, received);
+                break;
+            case switches::STALE:
+                if(status == protocol::ACK_OK){
+                    status = protocol::ACK_STALE;
+                }
+                ws::sendSwitchState(channel);
+                break;
+            default:
+                mask |= 1 << channel; // 같은 상태로 이동 중일 수 있음
+                break;
         }
     }
+    // 처음 요청한 연결에는 모든 채널의 현재 버전을 전송
+    for(uint8_t i = 0; subscribed && i < SWITCH_CHANNELS; ++i){
+        ws::sendSwitchState((ledc_channel_t) i);
+    }
+    return status;
 }
 
 static void webSocketHandler(void* object, esp_event_base_t base, int32_t eventId, void* eventData){
     esp_websocket_event_data_t* data = (esp_websocket_event_data_t*) eventData;
-    if(eventId == WEBSOCKET_EVENT_DATA && data->op_code == BINARY){
-        if(data->data_len != 1){
-            return;
+    if(eventId != WEBSOCKET_EVENT_DATA || data->op_code != BINARY || data->payload_offset != 0 || data->data_len != data->payload_len){
+        return;
+    }
+
+    int64_t received = esp_timer_get_time();
+    const uint8_t* frame = (const uint8_t*) data->data_ptr;
+    if(ota::handle(frame, data->data_len)){
+        return;
+    }
+    if(data->data_len > 1 && frame[0] == protocol::STATS_REQUEST_V2){
+        protocol::stats_request_t request;
+        if(protocol::decodeStatsRequest(frame, data->data_len, request)){
+            ws::sendStats(request.sequence, request.flags);
+        }
+        return;
+    }
+    if(data->data_len > 1 && frame[0] == protocol::PROFILE_REQUEST_V2){
+        uint16_t sequence;
+        if(protocol::decodeProfileRequest(frame, data->data_len, sequence)){
+            ws::sendProfile(sequence);
         }
-        ledc_channel_t channel = (ledc_channel_t) (data->data_ptr[0] >> 4);
-        bool state = data->data_ptr[0] & 0x01;
-        changeSwitchState(channel, state);
+        return;
+    }
+    if(data->data_len > 1 && frame[0] == protocol::SCHEDULE_SET_V2){
+        protocol::schedule_t schedule;
+        if(protocol::decodeScheduleSet(frame, data->data_len, schedule)){
+            ws::sendAck(schedule.sequence, schedule::set(schedule) ? protocol::ACK_OK : protocol::ACK_INVALID, esp_timer_get_time());
+        }
+        return;
+    }
+    if(data->data_len > 1 && frame[0] == protocol::SCHEDULE_GET_V2){
+        uint16_t sequence;
+        if(protocol::decodeScheduleGet(frame, data->data_len, sequence)){
+            ws::sendSchedule(sequence);
+        }
+        return;
+    }
+    if(data->data_len > 1 && frame[0] == protocol::CAPTURE_REQUEST_V2){
+        uint16_t sequence, duration;
+        if(protocol::decodeCaptureRequest(frame, data->data_len, sequence, duration) && !capture::start(sequence, duration)){
+            LOG_WARN("[Capture] 이미 기록 중입니다.");
+        }
+        return;
+    }
+
+    if(data->data_len > 1 && frame[0] == protocol::COMMAND_VERSIONED_V2){
+        protocol::versioned_t command;
+        if(protocol::decodeVersionedCommand(frame, data->data_len, command)){
+            outbox::version = 2;
+            uint8_t mask;
+            protocol::ack_status_t status = applyVersionedCommand(command, received, mask);
+            reactor::post(reactor::COMMAND_APPLIED, (mask << 24) | (status << 16) | command.sequence);
+        }
+        return;
+    }
+
+    protocol::command_t command;
+    if(!protocol::decodeCommand(frame, data->data_len, command)){
+        return;
+    }
+    if(command.version >= 2){
+        outbox::version = 2;
+    }
+
+    uint8_t mask;
+    protocol::ack_status_t status = applyCommand(command, received, protocol::ORIGIN_SERVER, mask);
+    if(command.version >= 2){
+        // 서보 동작 이벤트 뒤에 처리되도록 같은 큐로 전달
+        reactor::post(reactor::COMMAND_APPLIED, (mask << 24) | (status << 16) | command.sequence);
     }
 }
 
@@ -142,54 +247,224 @@ static void wifiHandler(void* arg, esp_event_base_t base, int32_t id, void* data
     }
 }
 
-static void wifiTask(void* args){
-    esp_err_t err = nvs_flash_init();
-    if(err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND){
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        err = nvs_flash_init();
+// servoStates: 마지막으로 서보에 반영한 상태, 종료 시점은 LEDC 페이드 완료 인터럽트 기준
+// 이동 중인 채널은 건너뛰고 도착(SERVO_SETTLED) 후 그때의 최신 상태로 한 번만 이동하므로 명령이 몰려도 서보가 흔들리지 않음
+static void updateServo(bool* servoStates){
+    storage::setSwitchStates(switches::bits());
+    for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+        if(servo::moving((ledc_channel_t) i)){
+            continue;
+        }
+        switches::snapshot_t snapshot = switches::load(i);
+        bool state = snapshot.state;
+        servoVersions[i] = snapshot.version;
+        if(state == servoStates[i]){
+            continue;
+        }
+        servoStates[i] = state;
+        const config::channel_t& channel = config::CHANNELS[i];
+        stats::record(stats::STATE_TO_SERVO, stats::stateTime[i]);
+        servo::move((ledc_channel_t) i, state ? channel.onDuty : channel.offDuty, channel.profile);
     }
-    ESP_ERROR_CHECK(err);
-    
-    storage::begin();
+}
+
+// 대상 채널의 서보 이동 명령이 나간 명령만 응답, 시각은 servo::move 직후
+// 이동 중이라 건너뛴 채널이나 합쳐진 이벤트는 도착(SERVO_SETTLED) 후 실제로 이동할 때 응답
+static void flushAcks(){
+    uint8_t kept = 0;
+    for(uint8_t i = 0; i < pendingAckCount; ++i){
+        const pending_ack_t& ack = pendingAcks[i];
+        bool ready = true;
+        for(uint8_t c = 0; c < SWITCH_CHANNELS; ++c){
+            if((ack.mask & (1 << c)) && servoVersions[c] < ack.versions[c]){
+                ready = false;
+            }
+        }
+        if(ready){
+            ws::sendAck(ack.sequence, ack.status, esp_timer_get_time());
+        }else{
+            pendingAcks[kept++] = ack;
+        }
+    }
+    pendingAckCount = kept;
+}
+
+// arg: COMMAND_APPLIED, 명령이 만든 버전은 이미 반영됐으므로 지금 버전을 기다림(이후 변경까지 포함될 수 있음)
+static void queueAck(int32_t arg){
+    if(pendingAckCount == ACK_PENDING_MAX){
+        // 가장 오래된 응답을 먼저 보냄
+        ws::sendAck(pendingAcks[0].sequence, pendingAcks[0].status, esp_timer_get_time());
+        memmove(pendingAcks, pendingAcks + 1, sizeof(pending_ack_t) * --pendingAckCount);
+    }
+    pending_ack_t& ack = pendingAcks[pendingAckCount++];
+    ack.sequence = arg & 0xFFFF;
+    ack.status = (protocol::ack_status_t) ((arg >> 16) & 0xFF);
+    ack.mask = (arg >> 24) & 0xFF;
+    for(uint8_t c = 0; c < SWITCH_CHANNELS; ++c){
+        ack.versions[c] = switches::load(c).version;
+    }
+}
+
+// 스위치, WiFi, 웹소켓 이벤트를 큐로 받아 처리, 대기 중에는 CPU를 점유하지 않음
+static void deviceTask(void* args){
     wifi::begin();
+    timesync::begin();
+#if POWER_MODE == POWER_MODE_DEEP_SLEEP
+    deepsleep::restoreSession();
+#endif
     ws::start(webSocketHandler);
+    lan::start(applyLanCommand);
 
     esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifiHandler, NULL);
     esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_AP_START, &wifiHandler, NULL);
 
+    // 재부팅 전 상태로 복원된 값, 서보는 이미 해당 위치에 있음
+    bool servoStates[SWITCH_CHANNELS];
+    for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+        switches::snapshot_t snapshot = switches::load(i);
+        servoStates[i] = snapshot.state;
+        servoVersions[i] = snapshot.version;
+    }
+    int64_t wifiTime = millis();
+    int64_t welcomeTime = -1; // 다음 환영 메시지 전송 시각, -1이면 즉시
+    backoff::Backoff welcomeBackoff(WEBSOCKET_WELCOME_BASE, WEBSOCKET_WELCOME_CAP);
     for(;;){
-        int64_t time = millis();
-        while(!wifi::connect){
-            if(
-                wifi::getMode() != WIFI_MODE_APSTA &&
-                millis() - time >= 6 * 1000
-            ){
-                wifi::setApMode();
+        int64_t timeout = -1;
+        int64_t now = millis();
+        if(!wifi::connect){
+            if(wifi::getMode() != WIFI_MODE_APSTA){
+                if(now - wifiTime >= 6 * 1000){
+                    wifi::setApMode();
+                }else{
+                    timeout = wifiTime + 6 * 1000 - now;
+                }
             }
+        }else if(!ws::connectServer && ws::isConnected()){
+            if(welcomeTime == -1 || now >= welcomeTime){
+                ws::greet(switches::bits(), welcomeTime == -1);
+                welcomeTime = now + welcomeBackoff.next();
+            }
+            timeout = welcomeTime - now;
+        }
+
+        reactor::event_t event;
+        if(!reactor::wait(&event, timeout)){
             continue;
         }
-        
-        time = millis();
-        while(!ws::connectServer){
-            if(!ws::isConnected() || millis() - time < 500){
-                continue;
-            }
-            time = millis();
-            ws::sendWelcome(upSwitchState, downSwitchState);
+        switch(event.type){
+            case reactor::SWITCH_CHANGED:
+                servoPending = false;
+                updateServo(servoStates);
+                flushAcks();
+                break;
+            case reactor::SERVO_SETTLED:
+                updateServo(servoStates);
+                flushAcks();
+                break;
+            case reactor::COMMAND_APPLIED:
+                queueAck(event.arg);
+                updateServo(servoStates);
+                flushAcks();
+                break;
+            case reactor::STORAGE_FLUSH:
+                storage::flush();
+                break;
+            case reactor::WIFI_CONNECTED:
+                lan::advertise();
+                break;
+            case reactor::WIFI_DISCONNECTED:
+                wifiTime = millis();
+                break;
+            case reactor::SERVER_CONNECTED:
+                ota::confirm();
+                telemetry::resync();
+                outbox::flush();
+#if POWER_MODE == POWER_MODE_DEEP_SLEEP
+                deepsleep::reportUnsent();
+                telemetry::send();
+                deepsleep::onReported();
+#endif
+                break;
+            case reactor::TELEMETRY_DUE:
+                telemetry::send();
+                break;
+            case reactor::TIME_SYNCED:
+            case reactor::SCHEDULE_DUE:
+                schedule::run();
+                break;
+#if POWER_MODE == POWER_MODE_DEEP_SLEEP
+            case reactor::SLEEP_DUE:
+                deepsleep::sleep();
+                break;
+#endif
+            case reactor::SOCKET_CONNECTED:
+            case reactor::SOCKET_DISCONNECTED:
+                pendingAckCount = 0; // 이전 연결의 명령 번호
+                welcomeBackoff.reset();
+                welcomeTime = -1;
+                break;
+            case reactor::RESUME_REJECTED:
+                welcomeTime = -1;
+                break;
+            default:
+                break;
         }
     }
 }
 
 extern "C" void app_main(){
-    servo::init(LEDC_CHANNEL_0, SERVO_UP_PIN);
-    servo::init(LEDC_CHANNEL_1, SERVO_DOWN_PIN);
+    esp_err_t err = nvs_flash_init();
+    if(err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND){
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
 
-    uint8_t index = 0;
-    TaskHandle_t handles[4];
-    xTaskCreatePinnedToCore(wifiTask, "wifi", 10000, NULL, 1, &handles[index++], 0);
-    xTaskCreatePinnedToCore(touchTask, "touch", 10000, NULL, 1, &handles[index++], 1);
-    xTaskCreatePinnedToCore(servoTask, "servo", 10000, NULL, 1, &handles[index++], 1);
-    xTaskCreatePinnedToCore(battery::calculate, "battery", 10000, NULL, 1, &handles[index++], 1);
+    logger::begin();
+    reactor::begin();
+    timesync::setTimezone();
+    ESP_ERROR_CHECK(storage::begin() ? ESP_OK : ESP_FAIL);
+#if POWER_MODE == POWER_MODE_DEEP_SLEEP
+    deepsleep::begin();
+#endif
+    // 버전은 재부팅해도 줄어들지 않음: deep sleep에서 깨어나면 잠들기 전 값, 전원이 켜지면 새 부팅 번호
+    uint16_t states = storage::getSwitchStates();
+    uint32_t versions[SWITCH_CHANNELS];
+#if POWER_MODE == POWER_MODE_DEEP_SLEEP
+    bool resumed = deepsleep::switchVersions(versions);
+#else
+    bool resumed = false;
+#endif
+    if(!resumed){
+        uint32_t version = switches::epochVersion(storage::nextEpoch());
+        for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+            versions[i] = version;
+        }
+    }
+    for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+        switches::restore(i, (states >> i) & 1, versions[i]);
+    }
+    power::begin();
+    for(uint8_t i = 0; i < SWITCH_CHANNELS; ++i){
+        servo::init((ledc_channel_t) i, (gpio_num_t) config::CHANNELS[i].servoPin);
+    }
+#if POWER_MODE == POWER_MODE_DEEP_SLEEP
+    // 깨운 터치는 WiFi, 터치 보정을 기다리지 않고 바로 구동(deviceTask는 바뀐 상태를 서보 위치로 인식)
+    int8_t wakeChannel = deepsleep::wakeTouch();
+    if(wakeChannel >= 0){
+        bool state = !switches::get(wakeChannel);
+        const config::channel_t& channel = config::CHANNELS[wakeChannel];
+        changeSwitchState((ledc_channel_t) wakeChannel, state, protocol::ORIGIN_TOUCH);
+        servo::move((ledc_channel_t) wakeChannel, state ? channel.onDuty : channel.offDuty, channel.profile);
+        deepsleep::actuated();
+    }
+#endif
+    profiler::begin();
+    ota::begin(ws::getSession);
+    telemetry::begin();
+    schedule::begin(changeSwitchState);
 
-    for(;;);
+    xTaskCreatePinnedToCore(deviceTask, "device", 10000, NULL, 1, NULL, 0);
+    xTaskCreatePinnedToCore(touchTask, "touch", 10000, NULL, 1, NULL, 1);
+    xTaskCreatePinnedToCore(battery::calculate, "battery", 10000, NULL, 1, NULL, 1);
 }
\ No newline at end of file
@@ -0,0 +1,7 @@
+# 빌드 시 정적 파일을 gzip으로 압축, mtime을 고정해 같은 입력이면 같은 결과가 나옴
+# python compress.py <입력> <출력>
+import gzip
+import sys
+
+with open(sys.argv[1], 'rb') as source, open(sys.argv[2], 'wb') as target:
+    target.write(gzip.compress(source.read(), compresslevel=9, mtime=0))
\ No newline at end of file